@@ -26,6 +26,12 @@
 
 namespace cocaine { namespace api {
 
+// Services are invoked by the engines, but every service has a reactor of its own, which runs its
+// timers, deferred completions and other internal tasks. Unless the service is reentrant, the reactor
+// is run by a single thread, so these handlers never run concurrently with each other. Reentrant
+// services might have their reactors run by multiple threads, and must serialize the handlers which
+// share some state themselves, e.g. by wrapping them with an asio::io_service::strand.
+
 struct service_t {
     typedef service_t category_type;
 
@@ -38,6 +44,13 @@ struct service_t {
     auto
     prototype() const -> const io::basic_dispatch_t& = 0;
 
+    // Whether the service's reactor might be run by multiple threads.
+    virtual
+    bool
+    reentrant() const {
+        return false;
+    }
+
 protected:
     service_t(context_t&, asio::io_service&, const std::string& /* name */, const dynamic_t& /* args */) {
         // Empty.
@@ -28,6 +28,8 @@
 
 #include "cocaine/traits.hpp"
 
+#include "cocaine/rpc/string_ref.hpp"
+
 #include <mutex>
 #include <sstream>
 
@@ -50,6 +52,16 @@ struct storage_t {
     write(const std::string& collection, const std::string& key, const std::string& blob,
           const std::vector<std::string>& tags) = 0;
 
+    // Writes a blob which is not owned by the caller, e.g. referencing the session's read buffer.
+    // Backends able to consume it in place should override this, by default the blob is copied.
+    virtual
+    void
+    write(const std::string& collection, const std::string& key, const io::string_ref_t& blob,
+          const std::vector<std::string>& tags)
+    {
+        write(collection, key, blob.str(), tags);
+    }
+
     virtual
     void
     remove(const std::string& collection, const std::string& key) = 0;
@@ -41,7 +41,9 @@ namespace cocaine {
 // Context
 
 class actor_t;
+class balancer_t;
 class execution_unit_t;
+class span_recorder_t;
 
 class context_t {
     COCAINE_DECLARE_NONCOPYABLE(context_t)
@@ -56,9 +58,21 @@ class context_t {
     // storages or isolates, have to be declared after this one.
     std::unique_ptr<api::repository_t> m_repository;
 
+    // Span recorder, only present if trace sampling is enabled.
+    std::unique_ptr<span_recorder_t> m_recorder;
+
+    // Remote address quotas, only present if they are configured.
+    std::unique_ptr<io::quota_table_t> m_quotas;
+
+    // CPU placement of the engine and service threads.
+    std::unique_ptr<io::affinity_t> m_affinity;
+
     // A pool of execution units - threads responsible for doing all the service invocations.
     std::vector<std::unique_ptr<execution_unit_t>> m_pool;
 
+    // Picks the execution unit for every new connection.
+    std::unique_ptr<balancer_t> m_balancer;
+
     // Services are stored as a vector of pairs to preserve the initialization order. Synchronized,
     // because services are allowed to start and stop other services during their lifetime.
     synchronized<service_list_t> m_services;
@@ -106,6 +120,20 @@ public:
     auto
     engine() -> execution_unit_t&;
 
+    auto
+    engines() const -> const std::vector<std::unique_ptr<execution_unit_t>>&;
+
+    auto
+    quotas() -> io::quota_table_t*;
+
+    auto
+    affinity() -> io::affinity_t&;
+
+    // Tracing
+
+    auto
+    recorder() -> span_recorder_t*;
+
 private:
     void
     bootstrap();
@@ -40,6 +40,44 @@ struct config_t {
     versions();
 
 public:
+    struct corking_t {
+        // Amount of pending data which triggers an immediate flush.
+        size_t bytes;
+
+        // Maximum time in milliseconds the messages might be held for. If zero, messages are only
+        // held until the end of the current reactor turn.
+        unsigned int latency;
+    };
+
+    struct admission_t {
+        // Queueing delay in milliseconds the engines are allowed to sustain while overloaded.
+        unsigned int target;
+
+        // Interval in milliseconds the queueing delay must stay above the target for the engine to
+        // be considered overloaded. Bursts shorter than that are absorbed.
+        unsigned int interval;
+    };
+
+    struct quota_t {
+        // Maximum number of concurrent incoming channels. Zero means no limit.
+        size_t channels;
+
+        // Sustained incoming message rate per second, zero means no limit, and the number of
+        // messages which might be sent at once on top of it.
+        unsigned int rate;
+        unsigned int burst;
+    };
+
+    struct placement_t {
+        // Whether the thread should be pinned to the next core in the automatic placement order,
+        // which interleaves the NUMA nodes.
+        bool automatic;
+
+        // Otherwise, the thread is pinned to these cores and to all the cores of these NUMA nodes.
+        std::vector<unsigned int> cores;
+        std::vector<unsigned int> nodes;
+    };
+
     struct {
         std::string plugins;
         std::string runtime;
@@ -57,6 +95,13 @@ public:
         // I/O thread pool size.
         size_t pool;
 
+        // Strategy new connections are spread over the I/O threads with, see balancer.hpp.
+        std::string balancer;
+
+        // Whether every I/O thread should accept connections on its own, with the kernel spreading
+        // them via SO_REUSEPORT. Bypasses the balancer for the TCP services.
+        bool reuseport;
+
         struct {
             // Pinned ports for static service port allocation.
             std::map<std::string, port_t> pinned;
@@ -64,8 +109,70 @@ public:
             // Port range to populate the dynamic port pool for service port allocation.
             std::tuple<port_t, port_t> shared;
         } ports;
+
+        struct {
+            // Whether idle sessions should give their read buffers back to the per-engine pool.
+            bool pooled;
+
+            // Maximum number of idle read buffers retained by every engine.
+            size_t capacity;
+        } buffers;
+
+        struct {
+            // Once this much data is queued for a client, sending more messages fails and reading
+            // from this client is suspended. Zero means no limit.
+            size_t high;
+
+            // Queued data size at which the session is considered drained again.
+            size_t low;
+        } watermarks;
+
+        // Per-service write coalescing settings. Messages sent to clients of these services will be
+        // gathered and written together, trading some latency for fewer system calls.
+        std::map<std::string, corking_t> corking;
+
+        // Per-service load shedding settings. New invocations of these services are rejected with
+        // a retryable error while the engine handling them is overloaded.
+        std::map<std::string, admission_t> admission;
+
+        // Client quotas, enforced both for every single session and for all the sessions of every
+        // remote address. Invocations over the quota are rejected with a protocol error, clients
+        // which keep streaming messages over the rate limit are disconnected.
+        struct {
+            quota_t session;
+            quota_t address;
+        } quotas;
+
+        // Whether header values sent to clients should be Huffman coded. Only takes effect for the
+        // clients which advertise the support for it themselves.
+        bool huffman;
     } network;
 
+    struct {
+        // Fraction of the traces which spans are recorded and exported. The decision is made by the
+        // trace id alone, so that every node samples the same traces. Zero disables the recorder.
+        double sample;
+
+        // File the recorded spans are appended to, as Zipkin JSON.
+        std::string path;
+
+        // Interval in milliseconds between the exports.
+        unsigned int interval;
+
+        // Number of span annotations buffered by every thread between the exports. Annotations
+        // which don't fit are dropped.
+        size_t buffer;
+    } tracing;
+
+    struct {
+        // Placement of the I/O threads, cycled over if there are less placements than threads. Not
+        // pinned if empty.
+        std::vector<placement_t> engines;
+
+        // Placement of the service threads.
+        std::map<std::string, placement_t> services;
+    } affinity;
+
     struct logging_t {
         struct logger_t {
             logging::priorities verbosity;
@@ -88,7 +195,18 @@ public:
 
     typedef std::map<std::string, component_t> component_map_t;
 
-    component_map_t services;
+    struct service_t {
+        std::string type;
+        dynamic_t   args;
+
+        // Number of threads running the service's reactor. Services which aren't reentrant are
+        // always run by a single thread, see api::service_t.
+        unsigned int threads;
+    };
+
+    typedef std::map<std::string, service_t> service_map_t;
+
+    service_map_t   services;
     component_map_t storages;
 
 #ifdef COCAINE_ALLOW_RAFT
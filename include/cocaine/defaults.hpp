@@ -36,6 +36,9 @@ struct defaults {
     // Defaults for logging service.
     static const std::string log_verbosity;
     static const std::string log_timestamp;
+
+    // Defaults for span recording.
+    static const std::string spans_path;
 };
 
 } // namespace cocaine
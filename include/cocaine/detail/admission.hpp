@@ -0,0 +1,91 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_IO_ADMISSION_HPP
+#define COCAINE_IO_ADMISSION_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace cocaine { namespace io {
+
+// Admission controller for the new invocations of a single service on a single engine, driven by the
+// engine's queueing delay, i.e. how late the engine's reactor gets around to its handlers.
+//
+// The engine is considered overloaded if the delay has stayed above the target for a whole interval,
+// like CoDel does with the packet queue sojourn time. Overloaded engines only admit invocations while
+// the delay is below the target, otherwise the delay is allowed to reach the whole interval, so that
+// short bursts are absorbed. Rejecting invocations is much cheaper than handling them, so shedding
+// drains the queue and keeps the delay of the admitted invocations bounded.
+
+class admission_t {
+public:
+    typedef std::chrono::steady_clock clock_type;
+
+    admission_t(clock_type::duration target, clock_type::duration interval);
+
+    // Feeds a queueing delay sample taken at the specified time. Must be called on the engine thread.
+    void
+    sample(clock_type::duration delay, clock_type::time_point now);
+
+    // Decides whether a new invocation should be handled. Must be called on the engine thread.
+    bool
+    admit();
+
+    // Observers, thread-safe
+
+    bool
+    overloaded() const {
+        return m_overloaded.load(std::memory_order_relaxed);
+    }
+
+    uint64_t
+    admitted() const {
+        return m_admitted.load(std::memory_order_relaxed);
+    }
+
+    uint64_t
+    shed() const {
+        return m_shed.load(std::memory_order_relaxed);
+    }
+
+private:
+    const clock_type::duration m_target;
+    const clock_type::duration m_interval;
+
+    // The most recent delay sample and the minimum one over the current interval.
+    clock_type::duration m_delay;
+    clock_type::duration m_minimum;
+
+    clock_type::time_point m_interval_end;
+
+    std::atomic<bool> m_overloaded;
+
+    std::atomic<uint64_t> m_admitted;
+    std::atomic<uint64_t> m_shed;
+
+    // Number of invocations shed before the current interval.
+    uint64_t m_shed_interval;
+};
+
+}} // namespace cocaine::io
+
+#endif
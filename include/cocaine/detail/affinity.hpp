@@ -0,0 +1,77 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_IO_AFFINITY_HPP
+#define COCAINE_IO_AFFINITY_HPP
+
+#include "cocaine/common.hpp"
+#include "cocaine/context/config.hpp"
+
+#include <atomic>
+
+namespace cocaine { namespace io {
+
+// CPU placement of the engine and service threads. Only the cores the process is allowed to run on
+// are used, NUMA nodes are discovered from sysfs. Threads pinned to the cores of a single node have
+// the memory they touch first allocated on that node, so the engines allocate their buffers lazily,
+// on their own threads.
+
+class affinity_t {
+    COCAINE_DECLARE_NONCOPYABLE(affinity_t)
+
+public:
+    typedef std::vector<unsigned int> cores_type;
+
+    explicit
+    affinity_t(const config_t& config);
+
+    // Cores the next engine thread should be pinned to. Empty if it shouldn't be pinned.
+    auto
+    engine() -> cores_type;
+
+    // Cores the thread of the specified service should be pinned to. Empty if it shouldn't be pinned.
+    auto
+    service(const std::string& name) -> cores_type;
+
+    auto
+    nodes() const -> size_t {
+        return m_nodes.size();
+    }
+
+private:
+    auto
+    resolve(const config_t::placement_t& placement) -> cores_type;
+
+    const std::vector<config_t::placement_t> m_engines;
+    const std::map<std::string, config_t::placement_t> m_services;
+
+    // Allowed cores of every NUMA node. A single node if the topology is unknown.
+    std::vector<cores_type> m_nodes;
+
+    // Allowed cores interleaving the NUMA nodes, which the automatic placement cycles through.
+    cores_type m_order;
+
+    std::atomic<size_t> m_engine;
+    std::atomic<size_t> m_next;
+};
+
+}} // namespace cocaine::io
+
+#endif
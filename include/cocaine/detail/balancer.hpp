@@ -0,0 +1,76 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_BALANCER_HPP
+#define COCAINE_BALANCER_HPP
+
+#include "cocaine/common.hpp"
+
+#include <atomic>
+
+namespace cocaine {
+
+class execution_unit_t;
+
+namespace io {
+
+// Instantaneous engine load. Updated by the engine's sessions as they are attached, detached, and as
+// their incoming channels are opened and revoked, so it moves as soon as the connections land.
+
+struct load_t {
+    load_t():
+        sessions(0),
+        channels(0)
+    { }
+
+    std::atomic<size_t> sessions;
+    std::atomic<size_t> channels;
+};
+
+} // namespace io
+
+// Engine balancing strategy, picks the engine for every new connection. Thread-safe.
+
+class balancer_t {
+public:
+    typedef std::vector<std::unique_ptr<execution_unit_t>> pool_type;
+
+    virtual
+   ~balancer_t() {
+        // Empty.
+    }
+
+    virtual
+    execution_unit_t&
+    select(const pool_type& pool) = 0;
+};
+
+// Strategies:
+//  * "load" picks the engine with the lowest CPU usage over the last minute.
+//  * "sessions" picks the engine with the least active sessions.
+//  * "channels" picks the engine with the least open incoming channels, then the least sessions.
+//  * "two-choices" compares two random engines the same way "channels" does, which is cheaper than
+//    scanning the whole pool.
+auto
+make_balancer(const std::string& strategy) -> std::unique_ptr<balancer_t>;
+
+} // namespace cocaine
+
+#endif
@@ -59,6 +59,10 @@ class chamber_t {
 
 public:
     chamber_t(const std::string& name, const std::shared_ptr<asio::io_service>& asio);
+
+    // Pins the thread to the specified cores, unless there are none.
+    chamber_t(const std::string& name, const std::shared_ptr<asio::io_service>& asio,
+              const std::vector<unsigned int>& cores);
    ~chamber_t();
 
     auto
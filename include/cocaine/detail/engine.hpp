@@ -24,9 +24,23 @@
 #include "cocaine/common.hpp"
 
 #include <asio/deadline_timer.hpp>
+#include <asio/ip/tcp.hpp>
 
 namespace cocaine {
 
+namespace io {
+
+class admission_t;
+struct load_t;
+
+#if defined(SO_REUSEPORT)
+// Allows multiple acceptors to listen on the same endpoint, with the kernel spreading the incoming
+// connections over them.
+typedef asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT> reuse_port;
+#endif
+
+} // namespace io
+
 class session_t;
 
 template<class Protocol>
@@ -35,26 +49,57 @@ class session;
 class execution_unit_t {
     COCAINE_DECLARE_NONCOPYABLE(execution_unit_t)
 
+    class accept_action_t;
     class gc_action_t;
+    class probe_action_t;
+
+    context_t& m_context;
 
     // Connections
 
     std::map<int, std::shared_ptr<session_t>> m_sessions;
 
+    // Instantaneous load, shared with the sessions which keep it up to date.
+    const std::shared_ptr<io::load_t> m_load;
+
     // I/O
 
     std::shared_ptr<asio::io_service> m_asio;
     std::unique_ptr<io::chamber_t> m_chamber;
 
+    // Shared read buffers for idle sessions, if enabled in the network configuration.
+    std::shared_ptr<io::buffer_pool_t> m_buffers;
+
     // Initialized here because of the dependency on the io::chamber_t's thread ID.
     const std::unique_ptr<logging::log_t> m_log;
 
     static const unsigned int kCollectionInterval = 60;
 
+    // Size of every pooled read buffer, big enough to fit most of the messages in one go.
+    static const size_t kPooledBufferSize = 65536;
+
     // Collects detached sessions every kCollectionInterval seconds. Normally, session slots will be
-    // reused because of system fd rotation, but for low loads this will help a bit.
+    // reused because of system fd rotation, but for low loads this will help a bit. Reports the read
+    // buffer pool and load shedding stats as well.
     std::unique_ptr<asio::deadline_timer> m_cron;
 
+    // Load shedding
+
+    static const unsigned int kProbeInterval = 1;
+
+    // Admission controllers of the services which have load shedding enabled. Constant.
+    std::map<std::string, std::shared_ptr<io::admission_t>> m_admission;
+
+    // Measures the reactor queueing delay for the admission controllers every kProbeInterval
+    // milliseconds, by how late it fires. Only armed if there are any.
+    std::unique_ptr<asio::deadline_timer> m_probe;
+
+    // Multi-acceptor mode
+
+    // Acceptors sharing the service endpoints with the other engines, by service name. Connections
+    // accepted here are served by this engine without being handed over from the service thread.
+    std::map<std::string, std::shared_ptr<asio::ip::tcp::acceptor>> m_acceptors;
+
 public:
     explicit
     execution_unit_t(context_t& context);
@@ -65,8 +110,32 @@ public:
     std::shared_ptr<session<typename Socket::protocol_type>>
     attach(std::unique_ptr<Socket> ptr, const io::dispatch_ptr_t& dispatch);
 
+    // Starts accepting connections for the specified dispatch on the endpoint, which must be bound
+    // with io::reuse_port by every acceptor sharing it. Binds in the calling thread, so that errors
+    // are reported to the caller.
+    void
+    listen(const asio::ip::tcp::endpoint& endpoint, const io::dispatch_ptr_t& dispatch);
+
+    // Stops accepting connections for the specified service. Established sessions are not affected.
+    void
+    unlisten(const std::string& name);
+
     double
     utilization() const;
+
+    auto
+    load() const -> const io::load_t&;
+
+    // Number of new invocations rejected so far due to overload, per service. The new ones are also
+    // logged every kCollectionInterval seconds.
+    auto
+    shed() const -> std::map<std::string, uint64_t>;
+
+private:
+    // Attaches a socket which already belongs to this engine's reactor.
+    template<class Socket>
+    std::shared_ptr<session<typename Socket::protocol_type>>
+    adopt(std::unique_ptr<Socket> ptr, const io::dispatch_ptr_t& dispatch);
 };
 
 } // namespace cocaine
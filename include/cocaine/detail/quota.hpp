@@ -0,0 +1,97 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_IO_QUOTA_HPP
+#define COCAINE_IO_QUOTA_HPP
+
+#include "cocaine/common.hpp"
+#include "cocaine/locked_ptr.hpp"
+
+#include <atomic>
+#include <chrono>
+
+namespace cocaine { namespace io {
+
+// Client quota. Limits the number of concurrent incoming channels and the rate of incoming messages,
+// either of a single session or of all the sessions of a single remote address. Thread-safe, since
+// sessions of the same address are spread over all the engines.
+//
+// The rate is limited with the generic cell rate algorithm, which is a token bucket that only keeps
+// the time the bucket will be full again, so that it can be updated with a single atomic operation.
+
+class quota_t {
+    COCAINE_DECLARE_NONCOPYABLE(quota_t)
+
+public:
+    typedef std::chrono::steady_clock clock_type;
+
+    // Zero channels or rate means no limit. Burst is the number of messages which might be sent at
+    // once on top of the rate.
+    quota_t(size_t channels, unsigned int rate, unsigned int burst);
+
+    // Accounts for a new channel, unless the limit has been reached.
+    bool
+    open();
+
+    void
+    close(size_t count = 1);
+
+    // Accounts for a new message, unless the rate limit has been exceeded.
+    bool
+    consume(clock_type::time_point now);
+
+private:
+    const size_t m_channels;
+
+    // Nanoseconds per message and the tolerated advance of the arrival time, i.e. the burst.
+    const int64_t m_period;
+    const int64_t m_tolerance;
+
+    std::atomic<size_t> m_opened;
+
+    // Theoretical arrival time of the next message, in nanoseconds since the clock epoch.
+    std::atomic<int64_t> m_arrival;
+};
+
+// Quotas of the remote addresses. Entries only live as long as there are sessions using them.
+
+class quota_table_t {
+    COCAINE_DECLARE_NONCOPYABLE(quota_table_t)
+
+public:
+    quota_table_t(size_t channels, unsigned int rate, unsigned int burst);
+
+    auto
+    get(const std::string& address) -> std::shared_ptr<quota_t>;
+
+private:
+    const size_t m_channels;
+    const unsigned int m_rate;
+    const unsigned int m_burst;
+
+    synchronized<std::map<std::string, std::weak_ptr<quota_t>>> m_quotas;
+
+    // Table size the expired entries are swept at. Guarded by the table lock.
+    size_t m_sweep_threshold;
+};
+
+}} // namespace cocaine::io
+
+#endif
@@ -42,9 +42,16 @@ public:
     auto
     prototype() const -> const io::basic_dispatch_t&;
 
+    // NOTE: The service doesn't use its reactor at all.
+    virtual
+    bool
+    reentrant() const {
+        return true;
+    }
+
 private:
     void
-    on_emit(logging::priorities level, std::string source, std::string message,
+    on_emit(logging::priorities level, std::string source, io::string_ref_t message,
             blackhole::attribute::set_t attributes);
 
     auto
@@ -28,15 +28,30 @@
 
 namespace cocaine { namespace service {
 
-struct storage_t:
+class storage_t:
     public api::service_t,
     public dispatch<io::storage_tag>
 {
+    // Workers the backend is accessed from, so that slow backends never block the engine threads.
+    // Only present if enabled in the service configuration.
+    std::shared_ptr<io::worker_pool_t> m_workers;
+
+    // Interval the worker stats are logged with, in seconds.
+    static const unsigned int kStatsInterval = 60;
+
+public:
     storage_t(context_t& context, asio::io_service& asio, const std::string& name, const dynamic_t& args);
 
     virtual
     auto
     prototype() const -> const io::basic_dispatch_t&;
+
+    // NOTE: The service only uses its reactor to log the worker stats, which is thread-safe.
+    virtual
+    bool
+    reentrant() const {
+        return true;
+    }
 };
 
 }} // namespace cocaine::service
@@ -53,6 +53,11 @@ public:
     write(const std::string& collection, const std::string& key, const std::string& blob,
           const std::vector<std::string>& tags);
 
+    virtual
+    void
+    write(const std::string& collection, const std::string& key, const io::string_ref_t& blob,
+          const std::vector<std::string>& tags);
+
     virtual
     void
     remove(const std::string& collection, const std::string& key);
@@ -42,7 +42,12 @@ enum dispatch_errors {
     revoked_channel,
     slot_not_found,
     unbound_dispatch,
-    uncaught_error
+    uncaught_error,
+    queue_overflow,
+    deadline_expired,
+    service_overloaded,
+    channel_quota_exceeded,
+    rate_limit_exceeded
 };
 
 enum repository_errors {
@@ -54,6 +54,8 @@ class chamber_t;
 
 // I/O streams
 
+class buffer_pool_t;
+
 template<class, class>
 class readable_stream;
 
@@ -68,6 +70,19 @@ struct decoder_t;
 template<class, class = encoder_t, class = decoder_t>
 struct transport;
 
+// Client quotas
+
+class quota_t;
+class quota_table_t;
+
+// Thread placement
+
+class affinity_t;
+
+// Offloading
+
+class worker_pool_t;
+
 // Generic RPC objects
 
 class basic_dispatch_t;
@@ -179,6 +179,13 @@ public:
     size_t
     http2_size() const;
 
+    /**
+     * @brief copy header data to user-provided memory and point header to that data.
+     * @param storage - at least get_name().size + get_value().size bytes long.
+     */
+    void
+    rebind(char* storage);
+
     friend struct msgpack_traits;
     friend struct headers;
     friend struct header_static_table_t;
@@ -300,6 +307,12 @@ struct header_static_table_t {
     const storage_t&
     get_headers();
 
+    // Index of the first entry with the same name as the entry at the specified index, which is the
+    // one name lookups resolve to.
+    static
+    size_t
+    name_idx(size_t idx);
+
     template<class Header>
     constexpr
     static
@@ -322,17 +335,13 @@ public:
     void
     push(const header_t& header);
 
-    inline
+    // Both lookups are hash-indexed and return 0 if nothing is found. Static table entries take
+    // precedence over the dynamic ones.
     size_t
-    find_by_full_match(const header_t& header) {
-        return find(std::bind(&header_t::operator==, &header, std::placeholders::_1));
-    }
+    find_by_full_match(const header_t& header) const;
 
-    inline
     size_t
-    find_by_name(const header_t& header) {
-        return find(std::bind(&header_t::name_equal, &header, std::placeholders::_1));
-    }
+    find_by_name(const header_t& header) const;
 
     size_t
     data_size() const;
@@ -351,18 +360,64 @@ public:
     //32 bytes overhead per record and 2 bytes for nil-nil header
     static constexpr size_t max_header_capacity = max_data_capacity / (http2_header_overhead + 2);
 
+    // Open-addressed hash index over table entries, which are identified by non-zero ids. Entries
+    // with equal hashes are told apart by the predicate passed to find().
+    class index_t {
+    public:
+        // Must be a power of two, at least twice as large as the number of indexed entries.
+        static constexpr size_t capacity = 256;
+
+        index_t();
+
+        void
+        insert(size_t hash, uint64_t id);
+
+        void
+        erase(size_t hash, uint64_t id);
+
+        template<class Predicate>
+        uint64_t
+        find(size_t hash, const Predicate& predicate) const {
+            for(size_t i = hash & (capacity - 1); slots[i].id; i = (i + 1) & (capacity - 1)) {
+                if(slots[i].hash == hash && predicate(slots[i].id)) {
+                    return slots[i].id;
+                }
+            }
+
+            return 0;
+        }
+
+    private:
+        struct slot_t {
+            size_t hash;
+            uint64_t id;
+        };
+
+        std::array<slot_t, capacity> slots;
+    };
+
+    static_assert(max_header_capacity * 2 <= index_t::capacity, "header index is too small");
+
 private:
     void
     pop();
 
-    size_t
-    find(const std::function<bool(const header_t&)> comp);
-
     // Header storage. Implemented as circular buffer
     std::array<header_t, max_header_capacity> headers;
     size_t header_lower_bound;
     size_t header_upper_bound;
 
+    // Number of headers ever pushed to and popped from the dynamic table. Dynamic entries are indexed
+    // by their sequence number plus one, the position in the circular buffer is derived from it.
+    uint64_t pushed;
+    uint64_t popped;
+
+    // Name and name+value hashes of the dynamic entries, kept to unindex the entries on pop().
+    std::array<std::pair<size_t, size_t>, max_header_capacity> hashes;
+
+    index_t by_name;
+    index_t by_entry;
+
     // Header data storage. Stores all data which headers can reference.
     // Implemented as a sort of circular buffer.
     // We multiply by 2 as data can be padded and we don't want to move it in memory.
@@ -374,4 +429,31 @@ private:
     size_t capacity;
 };
 
+// Cocaine specific headers which are deliberately not in the static table, so that the dynamic table
+// indices stay the same as for the peers which know nothing about them. Their indices start past the
+// largest one the dynamic table might ever reach, and are only sent to the peers which have advertised
+// their support with the extension_table header.
+struct header_extension_table_t {
+    typedef boost::mpl::vector1<
+        headers::deadline<>
+    > headers_storage;
+
+    static constexpr size_t offset = header_static_table_t::size + header_table_t::max_header_capacity;
+    static constexpr size_t size = boost::mpl::size<headers_storage>::type::value;
+    typedef std::array<header_t, size> storage_t;
+
+    static
+    const storage_t&
+    get_headers();
+
+    template<class Header>
+    constexpr
+    static
+    size_t
+    idx() {
+        static_assert(boost::mpl::contains<headers_storage, Header>::type::value, "Could not find header in extension table");
+        return offset + boost::mpl::find<headers_storage, Header>::type::pos::value;
+    }
+};
+
 }} // namespace cocaine::hpack
@@ -864,4 +864,59 @@ public:
             return header::create_data("parent_id");
         }
     };
+
+    // Advertises the support of Huffman coded header values. It's deliberately not in the static
+    // table, so that peers which don't know about it just ignore it.
+    template<class DefaultValue = default_values_t::empty_string_value_t>
+    struct huffman_coding:
+        public detail::value_mixin<DefaultValue>
+    {
+        static
+        constexpr
+        header::data_t
+        name() {
+            return header::create_data("huffman_coding");
+        }
+    };
+
+    // Advertises the support of the extension table. Not in any table either, for the same reason as
+    // the huffman_coding header.
+    template<class DefaultValue = default_values_t::empty_string_value_t>
+    struct extension_table:
+        public detail::value_mixin<DefaultValue>
+    {
+        static
+        constexpr
+        header::data_t
+        name() {
+            return header::create_data("extension_table");
+        }
+    };
+
+    // Trace, span and parent ids packed together, so that traced messages carry a single header. It's
+    // not in the static table either, it's sent with its name instead.
+    template<class DefaultValue = default_values_t::empty_string_value_t>
+    struct trace_context:
+        public detail::value_mixin<DefaultValue>
+    {
+        static
+        constexpr
+        header::data_t
+        name() {
+            return header::create_data("trace_context");
+        }
+    };
+
+    // Remaining time budget of an invocation in microseconds, measured when the message is encoded.
+    template<class DefaultValue = default_values_t::zero_uint_value_t>
+    struct deadline:
+        public detail::value_mixin<DefaultValue>
+    {
+        static
+        constexpr
+        header::data_t
+        name() {
+            return header::create_data("deadline");
+        }
+    };
 };
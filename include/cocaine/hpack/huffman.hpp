@@ -0,0 +1,51 @@
+﻿/*
+    Copyright (c) 2011-2015 Anton Matveenko <antmat@yandex-team.ru>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cocaine { namespace hpack { namespace huffman {
+
+// HPACK static Huffman code for header literals.
+// See https://tools.ietf.org/html/rfc7541#section-5.2
+
+// Returns the size of the encoded string in bytes, including the padding.
+size_t
+encoded_size(const char* data, size_t size);
+
+// Encodes the string, dest should be at least encoded_size() bytes long. Returns the encoded size.
+size_t
+encode(const char* data, size_t size, char* dest);
+
+// The shortest code is 5 bits long, so the decoded string is at most this long.
+inline
+size_t
+decoded_size_bound(size_t size) {
+    return size * 8 / 5;
+}
+
+// Decodes the string, dest should be at least decoded_size_bound() bytes long. Returns false if the
+// input is not a valid Huffman encoded string, otherwise the decoded size is stored.
+bool
+decode(const char* data, size_t size, char* dest, size_t& decoded);
+
+}}} // namespace cocaine::hpack::huffman
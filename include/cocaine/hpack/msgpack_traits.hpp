@@ -22,6 +22,7 @@
 #pragma once
 
 #include "cocaine/hpack/header.hpp"
+#include "cocaine/hpack/huffman.hpp"
 
 #include <msgpack/pack.hpp>
 #include <msgpack/object.hpp>
@@ -42,33 +43,88 @@ struct msgpack_traits {
     template<class Header, class Stream>
     static
     void
-    pack(msgpack::packer<Stream>& packer, header_table_t& table, const header::data_t& header_data) {
+    pack(msgpack::packer<Stream>& packer, header_table_t& table, const header::data_t& header_data, bool huffman = false) {
         size_t pos = header_static_table_t::idx<Header>();
         if(table[pos].get_value() == header_data) {
             packer.pack_fix_uint64(pos);
             return;
         }
-        packer.pack_array(3);
+        const size_t coded_size = huffman_size(header_data, huffman);
+        packer.pack_array(coded_size ? 4 : 3);
         header_t header(Header::name(), header_data);
         table.push(header);
         // true flag means store header in dynamic_table on receiver side
         packer.pack_true();
         packer.pack_fix_uint64(pos);
-        packer.pack_raw(header_data.size);
-        packer.pack_raw_body(header_data.blob, header_data.size);
+        pack_value(packer, header_data, coded_size);
+    }
+
+    // Pack a header which is not in static table with its default value, without storing it in the
+    // dynamic tables on either side
+    template<class Header, class Stream>
+    static
+    void
+    pack_literal(msgpack::packer<Stream>& packer) {
+        packer.pack_array(3);
+        packer.pack_false();
+        packer.pack_raw(Header::name().size);
+        packer.pack_raw_body(Header::name().blob, Header::name().size);
+        packer.pack_raw(Header::value().size);
+        packer.pack_raw_body(Header::value().blob, Header::value().size);
+    }
+
+    // Pack a header which is not in static table with a different value, without storing it in the
+    // dynamic tables on either side
+    template<class Header, class Stream>
+    static
+    void
+    pack_literal(msgpack::packer<Stream>& packer, const header::data_t& header_data, bool huffman = false) {
+        const size_t coded_size = huffman_size(header_data, huffman);
+        packer.pack_array(coded_size ? 4 : 3);
+        packer.pack_false();
+        packer.pack_raw(Header::name().size);
+        packer.pack_raw_body(Header::name().blob, Header::name().size);
+        pack_value(packer, header_data, coded_size);
+    }
+
+    // Pack a header from static table with a value which is unique for every message, without storing
+    // it in the dynamic tables on either side
+    template<class Header, class Stream>
+    static
+    void
+    pack_indexed(msgpack::packer<Stream>& packer, const header::data_t& header_data) {
+        static_assert(boost::mpl::contains<header_static_table_t::headers_storage, Header>::type::value, "Header is not present in static table");
+        packer.pack_array(3);
+        packer.pack_false();
+        packer.pack_fix_uint64(header_static_table_t::idx<Header>());
+        pack_value(packer, header_data, 0);
+    }
+
+    // Pack a header from extension table with a value which is unique for every message. Only for
+    // the peers which have advertised the support for the extension table
+    template<class Header, class Stream>
+    static
+    void
+    pack_extended(msgpack::packer<Stream>& packer, const header::data_t& header_data, bool huffman = false) {
+        const size_t coded_size = huffman_size(header_data, huffman);
+        packer.pack_array(coded_size ? 4 : 3);
+        packer.pack_false();
+        packer.pack_fix_uint64(header_extension_table_t::idx<Header>());
+        pack_value(packer, header_data, coded_size);
     }
 
     // Pack any other header
     template<class Stream>
     static
     void
-    pack(msgpack::packer<Stream>& packer, header_table_t& table, header_t& source) {
+    pack(msgpack::packer<Stream>& packer, header_table_t& table, header_t& source, bool huffman = false) {
         size_t pos = table.find_by_full_match(source);
         if(pos) {
             packer.pack_fix_uint64(pos);
             return;
         }
-        packer.pack_array(3);
+        const size_t coded_size = huffman_size(source.get_value(), huffman);
+        packer.pack_array(coded_size ? 4 : 3);
         pos = table.find_by_name(source);
         // true flag means store header in dynamic_table on receiver side
         packer.pack_true();
@@ -79,13 +135,16 @@ struct msgpack_traits {
             packer.pack_raw(source.get_name().size);
             packer.pack_raw_body(source.get_name().blob, source.get_name().size);
         }
-        packer.pack_raw(source.get_value().size);
-        packer.pack_raw_body(source.get_value().blob, source.get_value().size);
+        pack_value(packer, source.get_value(), coded_size);
     }
 
+    // Huffman coded values are followed by an extra true flag, which is only sent to the peers which
+    // have advertised the support for it with the huffman_coding header. Storage for the decoded
+    // values is requested from the allocator, which is called with the size in bytes.
+    template<class Allocator>
     static inline
     header_t
-    unpack(const msgpack::object& source, header_table_t& table) {
+    unpack(const msgpack::object& source, header_table_t& table, const Allocator& allocate) {
         // If header is fully from the table just fill it and return
         if(source.type == msgpack::type::POSITIVE_INTEGER) {
             if(source.via.u64 >= table.size() || source.via.u64 == 0) {
@@ -112,6 +171,17 @@ struct msgpack_traits {
         header_value.blob = value.via.raw.ptr;
         header_value.size = value.via.raw.size;
 
+        if(source.via.array.size > 3 && source.via.array.ptr[3].via.boolean) {
+            char* storage = allocate(huffman::decoded_size_bound(value.via.raw.size));
+            if(!huffman::decode(value.via.raw.ptr, value.via.raw.size, storage, header_value.size)) {
+                throw std::system_error(
+                    std::make_error_code(std::errc::invalid_argument),
+                    "Invalid Huffman coded header value"
+                );
+            }
+            header_value.blob = storage;
+        }
+
         // We don't need to store header in the table
         header_t result(header_name, header_value);
         if(!source.via.array.ptr[0].via.boolean) {
@@ -121,15 +191,21 @@ struct msgpack_traits {
         return result;
     }
 
+    template<class Allocator>
     static inline
     bool
-    unpack_vector(const msgpack::object& source, header_table_t& table, std::vector<header_t>& target) {
+    unpack_vector(const msgpack::object& source, header_table_t& table, std::vector<header_t>& target, const Allocator& allocate) {
         target.reserve(source.via.array.size);
         for (size_t i = 0; i < source.via.array.size; i++) {
             msgpack::object& obj = source.via.array.ptr[i];
             if(obj.type == msgpack::type::POSITIVE_INTEGER || (
                    obj.type == msgpack::type::ARRAY &&
-                   obj.via.array.size == 3 &&
+                   (obj.via.array.size == 3 || (
+                        // Huffman coded value flag
+                        obj.via.array.size == 4 &&
+                        obj.via.array.ptr[2].type == msgpack::type::RAW &&
+                        obj.via.array.ptr[3].type == msgpack::type::BOOLEAN
+                   )) &&
                    //Either to add header to dynamic table or not
                    obj.via.array.ptr[0].type == msgpack::type::BOOLEAN && (
                         //Either reference to table or raw data
@@ -143,7 +219,7 @@ struct msgpack_traits {
                )
             ) {
                 try {
-                    target.push_back(unpack(obj, table));
+                    target.push_back(unpack(obj, table, allocate));
                 } catch (...) {
                     // Just swallow it. We can not do anything here.
                     return false;
@@ -154,6 +230,42 @@ struct msgpack_traits {
         }
         return true;
     }
+
+private:
+    // Size of the Huffman coded value, or zero if the value is better sent as is.
+    static inline
+    size_t
+    huffman_size(const header::data_t& value, bool huffman) {
+        if(!huffman) {
+            return 0;
+        }
+        const size_t coded_size = huffman::encoded_size(value.blob, value.size);
+        return coded_size < value.size ? coded_size : 0;
+    }
+
+    // NOTE: Huffman coded values are written from a temporary buffer, so the stream must copy them
+    // rather than keep a reference.
+    template<class Stream>
+    static
+    void
+    pack_value(msgpack::packer<Stream>& packer, const header::data_t& value, size_t coded_size) {
+        if(!coded_size) {
+            packer.pack_raw(value.size);
+            packer.pack_raw_body(value.blob, value.size);
+            return;
+        }
+        char small[256];
+        std::vector<char> large;
+        char* buffer = small;
+        if(coded_size > sizeof(small)) {
+            large.resize(coded_size);
+            buffer = large.data();
+        }
+        huffman::encode(value.blob, value.size, buffer);
+        packer.pack_raw(coded_size);
+        packer.pack_raw_body(buffer, coded_size);
+        packer.pack_true();
+    }
 };
 
 }} // namespace cocaine::hpack
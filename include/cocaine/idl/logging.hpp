@@ -22,6 +22,7 @@
 #define COCAINE_LOGGING_SERVICE_INTERFACE_HPP
 
 #include "cocaine/rpc/protocol.hpp"
+#include "cocaine/rpc/string_ref.hpp"
 
 #include <blackhole/attribute.hpp>
 
@@ -48,8 +49,8 @@ struct emit {
         'app/<name>' so that they could be routed separately. */
         std::string,
      /* Log message. Some meaningful string, with no explicit limits on its length, although
-        underlying loggers might silently truncate it. */
-        std::string,
+        underlying loggers might silently truncate it. Not copied unless actually logged. */
+        string_ref_t,
      /* Log event attached attributes. */
         optional<blackhole::attribute::set_t>
     >::type argument_type;
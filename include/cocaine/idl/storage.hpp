@@ -22,6 +22,7 @@
 #define COCAINE_STORAGE_SERVICE_INTERFACE_HPP
 
 #include "cocaine/rpc/protocol.hpp"
+#include "cocaine/rpc/string_ref.hpp"
 
 namespace cocaine { namespace io {
 
@@ -66,8 +67,8 @@ struct write {
      /* Key. */
         std::string,
      /* Value. Typically, it should be serialized with msgpack, so that the future reader could
-        assume that it can be deserialized safely. */
-        std::string,
+        assume that it can be deserialized safely. Not copied out of the incoming message. */
+        string_ref_t,
      /* Tag list. Imagine these are your indexes. */
         optional<std::vector<std::string>>
     >::type argument_type;
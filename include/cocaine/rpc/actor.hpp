@@ -48,8 +48,12 @@ class actor_t {
     // allow concurrent observing and operations.
     synchronized<std::unique_ptr<asio::ip::tcp::acceptor>> m_acceptor;
 
-    // Main service thread.
-    std::unique_ptr<io::chamber_t> m_chamber;
+    // Whether the service's reactor might be run by multiple threads. Constant.
+    bool m_reentrant;
+
+    // Service threads, all running the same reactor. There's only one, unless the service is
+    // reentrant and configured to have more.
+    std::vector<std::unique_ptr<io::chamber_t>> m_chambers;
 
 public:
     actor_t(context_t& context, const std::shared_ptr<asio::io_service>& asio,
@@ -78,6 +82,11 @@ public:
 
     void
     terminate();
+
+private:
+    // Binds the acceptor in multi-acceptor mode and starts accepting on every engine.
+    void
+    bind(std::unique_ptr<asio::ip::tcp::acceptor>& ptr, const asio::ip::tcp::endpoint& endpoint);
 };
 
 } // namespace cocaine
@@ -0,0 +1,101 @@
+/*
+    Copyright (c) 2011-2015 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_IO_ARENA_HPP
+#define COCAINE_IO_ARENA_HPP
+
+#include "cocaine/common.hpp"
+
+namespace cocaine { namespace io {
+
+// Bump allocator for the per-message data with the lifetime of a single decoded frame. Memory blocks
+// are never returned to the heap until the arena is destroyed, so once it has grown to fit the peak
+// per-frame footprint, both allocations and resets never touch the global heap again.
+
+class arena_t {
+    COCAINE_DECLARE_NONCOPYABLE(arena_t)
+
+    typedef std::vector<char, uninitialized<char>> block_type;
+
+    // Good enough for any fundamental type on the supported platforms.
+    static const size_t kDefaultAlignment = 16;
+
+    const size_t m_block_size;
+
+    std::vector<block_type> m_blocks;
+
+    // Current block and the offset of the first free byte in it.
+    size_t m_block;
+    size_t m_offset;
+
+public:
+    explicit
+    arena_t(size_t block_size = 4096):
+        m_block_size(block_size),
+        m_block(0),
+        m_offset(0)
+    { }
+
+    auto
+    allocate(size_t size, size_t alignment = kDefaultAlignment) -> char* {
+        while(m_block < m_blocks.size()) {
+            block_type& block = m_blocks[m_block];
+
+            const size_t offset = (m_offset + alignment - 1) & ~(alignment - 1);
+
+            if(offset + size <= block.size()) {
+                m_offset = offset + size;
+                return block.data() + offset;
+            }
+
+            // Skip to the next retained block, the tail of this one stays unused until the reset.
+            m_block++;
+            m_offset = 0;
+        }
+
+        m_blocks.emplace_back(std::max(size, m_block_size));
+        m_offset = size;
+
+        return m_blocks.back().data();
+    }
+
+    // Makes all the memory available for reuse, invalidating every pointer ever allocated.
+    void
+    reset() {
+        m_block = 0;
+        m_offset = 0;
+    }
+
+    // Total amount of memory owned by the arena.
+    auto
+    capacity() const -> size_t {
+        size_t result = 0;
+
+        for(auto it = m_blocks.begin(); it != m_blocks.end(); ++it) {
+            result += it->size();
+        }
+
+        return result;
+    }
+};
+
+}} // namespace cocaine::io
+
+#endif
@@ -0,0 +1,119 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_IO_BUFFER_POOL_HPP
+#define COCAINE_IO_BUFFER_POOL_HPP
+
+#include "cocaine/common.hpp"
+#include "cocaine/locked_ptr.hpp"
+
+namespace cocaine { namespace io {
+
+// Read buffers shared by all the sessions of an execution unit. Idle sessions don't own any memory
+// at all, they borrow a buffer only when there's some data to read and return it once it's drained.
+
+class buffer_pool_t {
+    COCAINE_DECLARE_NONCOPYABLE(buffer_pool_t)
+
+public:
+    typedef std::vector<char, uninitialized<char>> buffer_type;
+
+    struct stats_t {
+        // Number of buffers waiting in the pool.
+        size_t idle;
+
+        // Number of buffers currently owned by sessions.
+        size_t borrowed;
+    };
+
+private:
+    struct state_t {
+        std::vector<buffer_type> idle;
+        size_t borrowed;
+    };
+
+    const size_t m_buffer_size;
+
+    // Maximum number of idle buffers retained for reuse.
+    const size_t m_capacity;
+
+    synchronized<state_t> m_state;
+
+public:
+    buffer_pool_t(size_t buffer_size, size_t capacity):
+        m_buffer_size(buffer_size),
+        m_capacity(capacity),
+        m_state(state_t{std::vector<buffer_type>(), 0})
+    { }
+
+    auto
+    acquire() -> buffer_type {
+        buffer_type buffer;
+
+        m_state.apply([&](state_t& state) {
+            if(!state.idle.empty()) {
+                buffer = std::move(state.idle.back());
+                state.idle.pop_back();
+            }
+
+            state.borrowed++;
+        });
+
+        if(buffer.empty()) {
+            // The pool is exhausted, so allocate outside of the lock.
+            buffer.resize(m_buffer_size);
+        }
+
+        return buffer;
+    }
+
+    void
+    release(buffer_type&& buffer) {
+        buffer_type dropped;
+
+        m_state.apply([&](state_t& state) {
+            state.borrowed--;
+
+            // NOTE: Buffers which have grown during a burst are not retained, so that the memory is
+            // returned back to the system as soon as the burst is over.
+            if(buffer.size() == m_buffer_size && state.idle.size() < m_capacity) {
+                state.idle.push_back(std::move(buffer));
+            } else {
+                dropped = std::move(buffer);
+            }
+        });
+    }
+
+    auto
+    buffer_size() const -> size_t {
+        return m_buffer_size;
+    }
+
+    auto
+    stats() const -> stats_t {
+        return m_state.apply([](const state_t& state) -> stats_t {
+            return stats_t{state.idle.size(), state.borrowed};
+        });
+    }
+};
+
+}} // namespace cocaine::io
+
+#endif
@@ -28,8 +28,13 @@
 
 #include "cocaine/traits.hpp"
 
+#include "cocaine/rpc/asio/arena.hpp"
+
 #include <boost/range/algorithm/find_if.hpp>
 
+#include <array>
+#include <limits>
+
 namespace cocaine { namespace io {
 
 struct decoder_t;
@@ -54,9 +59,52 @@ struct decoded_message_t {
         return object.via.array.ptr[2];
     }
 
+    decoded_message_t():
+        overflow(false)
+    {
+        positions.fill(0);
+    }
+
+    // Headers known to the static table are looked up by their static index in constant time, the
+    // others are looked up by name.
     template<class Header>
     auto
     meta() const -> boost::optional<hpack::header_t> {
+        typedef typename boost::mpl::contains<
+            hpack::header_static_table_t::headers_storage,
+            Header
+        >::type is_static;
+
+        return find<Header>(is_static());
+    }
+
+    void
+    clear() {
+        if(!metadata.empty()) {
+            positions.fill(0);
+        }
+
+        metadata.clear();
+        overflow = false;
+    }
+
+private:
+    template<class Header>
+    auto
+    find(boost::mpl::true_) const -> boost::optional<hpack::header_t> {
+        const size_t position = positions[hpack::header_static_table_t::name_idx(
+            hpack::header_static_table_t::idx<Header>())];
+
+        if(position) {
+            return metadata[position - 1];
+        }
+
+        return overflow ? find<Header>(boost::mpl::false_()) : boost::none;
+    }
+
+    template<class Header>
+    auto
+    find(boost::mpl::false_) const -> boost::optional<hpack::header_t> {
         auto it = boost::find_if(metadata, [](const hpack::header_t& element) -> bool {
             return element.get_name() == Header::name();
         });
@@ -64,15 +112,191 @@ struct decoded_message_t {
         return it == metadata.end() ? boost::none : boost::make_optional(*it);
     }
 
+    // Records that the header at the specified position has a name from the static table.
     void
-    clear() {
-        metadata.clear();
+    record(size_t idx, size_t position) {
+        if(position >= std::numeric_limits<uint8_t>::max()) {
+            overflow = true;
+        } else if(!positions[idx]) {
+            // The first header wins, just like with the name lookup.
+            positions[idx] = static_cast<uint8_t>(position + 1);
+        }
     }
 
-private:
     // These objects keep references to message buffer in the Decoder.
     msgpack::object object;
     std::vector<hpack::header_t> metadata;
+
+    // Positions of the headers in the metadata, plus one, by the static index of their names.
+    std::array<uint8_t, hpack::header_static_table_t::size> positions;
+
+    // Some headers didn't fit into the positions, so lookups have to fall back to the name scan.
+    bool overflow;
+};
+
+// Resumable MessagePack frame boundary scanner. It walks the wire format without constructing any
+// objects and remembers where it stopped, so that partially received frames are not re-parsed from
+// scratch every time some more bytes arrive.
+
+class frame_scanner_t {
+    // Same nesting limit as the one used by the MessagePack unpacker itself.
+    static const size_t kMaxDepth = 32;
+
+    // Offset of the first byte which hasn't been scanned yet, relative to the frame start. It might
+    // point beyond the available data, if the last scanned element has a large body.
+    size_t m_offset;
+
+    // Number of elements left to scan on every nesting level.
+    std::vector<uint64_t> m_pending;
+
+    // Total number of elements scanned so far.
+    size_t m_elements;
+
+public:
+    frame_scanner_t() {
+        reset();
+    }
+
+    // Returns true if the whole frame is available, in which case its size is reported by offset().
+    bool
+    scan(const char* data, size_t size, std::error_code& ec) {
+        const unsigned char* ptr = reinterpret_cast<const unsigned char*>(data);
+
+        while(!m_pending.empty()) {
+            if(m_pending.back() == 0) {
+                m_pending.pop_back();
+                continue;
+            }
+
+            if(m_offset >= size) {
+                return false;
+            }
+
+            size_t header = 1, body = 0;
+            uint64_t children = 0;
+
+            const unsigned char type = ptr[m_offset];
+
+            if(type <= 0x7f || type >= 0xe0) {
+                // Positive and negative fixints.
+            } else if(type <= 0x8f) {
+                children = (type & 0x0f) * 2;
+            } else if(type <= 0x9f) {
+                children = type & 0x0f;
+            } else if(type <= 0xbf) {
+                body = type & 0x1f;
+            } else {
+                switch(type) {
+                case 0xc0: case 0xc2: case 0xc3:
+                    break;
+                case 0xcc: case 0xd0:
+                    header = 2; break;
+                case 0xcd: case 0xd1:
+                    header = 3; break;
+                case 0xca: case 0xce: case 0xd2:
+                    header = 5; break;
+                case 0xcb: case 0xcf: case 0xd3:
+                    header = 9; break;
+                case 0xd4: case 0xd5: case 0xd6: case 0xd7: case 0xd8:
+                    // Fixexts: type byte followed by 1, 2, 4, 8 or 16 bytes of data.
+                    header = 2; body = 1 << (type - 0xd4); break;
+                case 0xc4: case 0xd9:
+                    header = 2; break;
+                case 0xc5: case 0xda: case 0xdc: case 0xde:
+                    header = 3; break;
+                case 0xc6: case 0xdb: case 0xdd: case 0xdf:
+                    header = 5; break;
+                case 0xc7:
+                    header = 3; break;
+                case 0xc8:
+                    header = 4; break;
+                case 0xc9:
+                    header = 6; break;
+                default:
+                    ec = error::parse_error;
+                    return false;
+                }
+            }
+
+            if(m_offset + header > size) {
+                // The element header itself is incomplete, wait for more data.
+                return false;
+            }
+
+            switch(type) {
+            case 0xc4: case 0xd9:
+                body = ptr[m_offset + 1]; break;
+            case 0xc5: case 0xda:
+                body = load<uint16_t>(ptr + m_offset + 1); break;
+            case 0xc6: case 0xdb:
+                body = load<uint32_t>(ptr + m_offset + 1); break;
+            case 0xdc: case 0xde:
+                children = load<uint16_t>(ptr + m_offset + 1); break;
+            case 0xdd: case 0xdf:
+                children = load<uint32_t>(ptr + m_offset + 1); break;
+            case 0xc7:
+                body = ptr[m_offset + 1]; break;
+            case 0xc8:
+                body = load<uint16_t>(ptr + m_offset + 1); break;
+            case 0xc9:
+                body = load<uint32_t>(ptr + m_offset + 1); break;
+            }
+
+            if(type == 0xde || type == 0xdf) {
+                children *= 2;
+            }
+
+            m_pending.back()--;
+            m_offset += header + body;
+            m_elements++;
+
+            if(children) {
+                if(m_pending.size() == kMaxDepth) {
+                    ec = error::parse_error;
+                    return false;
+                }
+
+                m_pending.push_back(children);
+            }
+        }
+
+        return m_offset <= size;
+    }
+
+    void
+    reset() {
+        m_offset = 0;
+        m_pending.assign(1, 1);
+        m_elements = 0;
+    }
+
+    // Minimal number of bytes needed to make progress. Once the frame is completely scanned, it is
+    // equal to the frame size.
+    size_t
+    offset() const {
+        return m_offset;
+    }
+
+    // Number of elements in the frame, which is enough to estimate the unpacked object tree size.
+    size_t
+    elements() const {
+        return m_elements;
+    }
+
+private:
+    template<class T>
+    static
+    T
+    load(const unsigned char* ptr) {
+        T value = 0;
+
+        // MessagePack uses the big-endian byte order for all the multibyte quantities.
+        for(size_t i = 0; i < sizeof(T); ++i) {
+            value = static_cast<T>((value << 8) | ptr[i]);
+        }
+
+        return value;
+    }
 };
 
 } // namespace aux
@@ -80,7 +304,16 @@ private:
 struct decoder_t {
     COCAINE_DECLARE_NONCOPYABLE(decoder_t)
 
-    decoder_t() = default;
+    // Initial and maximum zone chunk sizes. The zone chunk grows to fit the object tree of the largest
+    // frame seen so far, so that the unpacker doesn't allocate any memory in steady state.
+    static const size_t kInitialZoneSize = 8192;
+    static const size_t kMaximumZoneSize = 1048576;
+
+    decoder_t():
+        zone(new msgpack::zone(kInitialZoneSize)),
+        zone_size(kInitialZoneSize)
+    { }
+
    ~decoder_t() = default;
 
     typedef aux::decoded_message_t message_type;
@@ -89,12 +322,34 @@ struct decoder_t {
     decode(const char* data, size_t size, message_type& message, std::error_code& ec) {
         size_t offset = 0;
 
+        // NOTE: The scanner keeps its progress between the calls, so every received byte is walked
+        // over only once, no matter how many reads it takes to receive the whole frame.
+        if(!scanner.scan(data, size, ec)) {
+            if(!ec) {
+                ec = error::insufficient_bytes;
+            } else {
+                scanner.reset();
+            }
+
+            return offset;
+        }
+
+        // The frame is complete, so it's unpacked exactly once.
+        size = scanner.offset();
+
+        // Every unpacked element takes at most one object slot in the zone.
+        reserve(scanner.elements() * sizeof(msgpack::object));
+
+        scanner.reset();
+
         // NOTE: We have to clear msgpack zone every decoding iteration to prevent memory leaking
         // for objects structure, because they have no way to notify about self-destruction. Hope
-        // someday we migrate to v1.* and everything will be fine automatically.
-        zone.clear();
+        // someday we migrate to v1.* and everything will be fine automatically. As long as the frame
+        // fits into the first zone chunk, this doesn't free anything.
+        zone->clear();
+        arena.reset();
 
-        msgpack::unpack_return rv = msgpack::unpack(data, size, &offset, &zone, &message.object);
+        msgpack::unpack_return rv = msgpack::unpack(data, size, &offset, zone.get(), &message.object);
 
         if(rv == msgpack::UNPACK_SUCCESS || rv == msgpack::UNPACK_EXTRA_BYTES) {
             if(message.object.type != msgpack::type::ARRAY || message.object.via.array.size < 3) {
@@ -108,9 +363,13 @@ struct decoder_t {
                 if(message.object.via.array.ptr[3].type != msgpack::type::ARRAY) {
                     ec = error::frame_format_error;
                 } else if(!hpack::msgpack_traits::unpack_vector(
-                          message.object.via.array.ptr[3], hpack_context, message.metadata))
+                          message.object.via.array.ptr[3], hpack_context, message.metadata,
+                          [this](size_t size) { return arena.allocate(size, 1); }))
                 {
                     ec = error::hpack_error;
+                } else {
+                    index(message, message.object.via.array.ptr[3]);
+                    rebind(message.metadata);
                 }
             }
         } else if(rv == msgpack::UNPACK_CONTINUE) {
@@ -122,8 +381,72 @@ struct decoder_t {
         return offset;
     }
 
+    // Number of bytes the pending frame is known to occupy so far, used for read buffer sizing.
+    size_t
+    required() const {
+        return scanner.offset();
+    }
+
 private:
-    msgpack::zone zone;
+    void
+    index(message_type& message, const msgpack::object& source) {
+        const size_t base = message.metadata.size() - source.via.array.size;
+
+        for(size_t i = 0; i < source.via.array.size; ++i) {
+            const msgpack::object& header = source.via.array.ptr[i];
+
+            size_t idx = 0;
+
+            // Headers either refer to the table entry as a whole or to its name only.
+            if(header.type == msgpack::type::POSITIVE_INTEGER) {
+                idx = header.via.u64;
+            } else if(header.via.array.ptr[1].type == msgpack::type::POSITIVE_INTEGER) {
+                idx = header.via.array.ptr[1].via.u64;
+            }
+
+            if(idx == 0 || idx >= hpack::header_static_table_t::size) {
+                // Literal names and dynamic table entries might still have static names.
+                idx = hpack_context.find_by_name(message.metadata[base + i]);
+            }
+
+            if(idx == 0 || idx >= hpack::header_static_table_t::size) {
+                continue;
+            }
+
+            message.record(hpack::header_static_table_t::name_idx(idx), base + i);
+        }
+    }
+
+    void
+    reserve(size_t size) {
+        if(size <= zone_size || zone_size >= kMaximumZoneSize) {
+            return;
+        }
+
+        while(zone_size < size && zone_size < kMaximumZoneSize) {
+            zone_size *= 2;
+        }
+
+        zone.reset(new msgpack::zone(zone_size));
+    }
+
+    void
+    rebind(std::vector<hpack::header_t>& metadata) {
+        // NOTE: Decoded headers point either into the read buffer or into the HPACK dynamic table,
+        // which might be evicted by table updates, so their data is moved into the arena. It's reset
+        // with every frame, which is exactly the lifetime of the message metadata.
+        for(auto it = metadata.begin(); it != metadata.end(); ++it) {
+            it->rebind(arena.allocate(it->get_name().size + it->get_value().size, 1));
+        }
+    }
+
+    aux::frame_scanner_t scanner;
+
+    std::unique_ptr<msgpack::zone> zone;
+    size_t zone_size;
+
+    // Storage for the decoded header data.
+    arena_t arena;
 
     // HPACK HTTP/2.0 tables.
     hpack::header_table_t hpack_context;
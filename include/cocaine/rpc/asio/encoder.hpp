@@ -28,12 +28,18 @@
 
 #include "cocaine/rpc/protocol.hpp"
 
+#include "cocaine/rpc/deadline.hpp"
+
 #include "cocaine/trace/trace.hpp"
 
 #include "cocaine/traits.hpp"
 #include "cocaine/traits/tuple.hpp"
 
 #include <cstring>
+#include <new>
+#include <type_traits>
+
+#include <asio/buffer.hpp>
 
 namespace cocaine { namespace io {
 
@@ -46,17 +52,35 @@ namespace aux {
 
 struct encoded_buffers_t {
     friend struct encoded_message_t;
+    friend struct io::encoder_t;
 
     static const size_t kInitialBufferSize = 2048;
 
+    // Raw bodies of at least this size are referenced as separate segments instead of being copied
+    // into the buffer, so that large blobs are handed over to the socket without any copying.
+    static const size_t kReferenceThreshold = 8192;
+
     encoded_buffers_t():
-        offset(0)
+        offset(0),
+        cursor(0),
+        referenced(0)
     {
         vector.resize(kInitialBufferSize);
     }
 
     void
     write(const char* data, size_t size) {
+        if(size >= kReferenceThreshold) {
+            return reference(data, size);
+        }
+
+        write_copy(data, size);
+    }
+
+    // Copies the data into the buffer regardless of its size, for the data which doesn't outlive the
+    // encoding, like the Huffman coded header values.
+    void
+    write_copy(const char* data, size_t size) {
         while(size > vector.size() - offset) {
             vector.resize(vector.size() * 2);
         }
@@ -66,6 +90,30 @@ struct encoded_buffers_t {
         offset += size;
     }
 
+    // Appends the buffer segments to the specified buffer sequence.
+    template<class OutputIterator>
+    void
+    buffers(OutputIterator it) const {
+        for(auto segment = segments.begin(); segment != segments.end(); ++segment) {
+            if(segment->blob) {
+                *it++ = asio::const_buffer(segment->blob, segment->size);
+            } else {
+                *it++ = asio::const_buffer(vector.data() + segment->offset, segment->size);
+            }
+        }
+
+        if(offset > cursor) {
+            *it++ = asio::const_buffer(vector.data() + cursor, offset - cursor);
+        }
+    }
+
+    // Rewinds the buffer, keeping the memory allocated.
+    void
+    reset() {
+        offset = cursor = referenced = 0;
+        segments.clear();
+    }
+
     // Movable
 
     encoded_buffers_t(encoded_buffers_t&&) = default;
@@ -76,34 +124,232 @@ struct encoded_buffers_t {
     COCAINE_DECLARE_NONCOPYABLE(encoded_buffers_t)
 
 private:
+    void
+    reference(const char* data, size_t size) {
+        if(offset > cursor) {
+            // Seal the inlined data written so far, so that the segments stay in the right order.
+            segments.push_back(segment_t{nullptr, cursor, offset - cursor});
+            cursor = offset;
+        }
+
+        segments.push_back(segment_t{data, 0, size});
+
+        referenced += size;
+    }
+
+    struct segment_t {
+        // Referenced external data, or nullptr for the inlined data stored in the vector, in which
+        // case the offset is used instead, as the vector might be reallocated.
+        const char* blob;
+        size_t offset;
+        size_t size;
+    };
+
     std::vector<char, uninitialized<char>> vector;
     std::vector<char, uninitialized<char>>::size_type offset;
+
+    // Beginning of the trailing inlined data which is not sealed into a segment yet.
+    std::vector<char, uninitialized<char>>::size_type cursor;
+
+    std::vector<segment_t> segments;
+    size_t referenced;
+};
+
+// Stream adapter which copies everything written through it. Message metadata is packed through it,
+// as it is packed from temporaries, which are gone by the time the message is sent.
+struct copied_buffers_t {
+    explicit
+    copied_buffers_t(encoded_buffers_t& target_): target(target_) { }
+
+    void
+    write(const char* data, size_t size) {
+        target.write_copy(data, size);
+    }
+
+private:
+    encoded_buffers_t& target;
 };
 
 struct encoded_message_t {
     friend struct io::encoder_t;
 
-    auto
-    data() const -> const char* {
-        return buffer.vector.data();
+    // Appends the message segments to the specified buffer sequence. Referenced segments point to
+    // the message arguments, so the unbound message must outlive the encoded one.
+    template<class OutputIterator>
+    void
+    buffers(OutputIterator it) const {
+        buffer.buffers(it);
     }
 
     size_t
     size() const {
-        return buffer.offset;
+        return buffer.offset + buffer.referenced;
     }
 
 private:
+    explicit
+    encoded_message_t(encoded_buffers_t&& buffer_): buffer(std::move(buffer_)) { }
+
     encoded_buffers_t buffer;
 };
 
-struct unbound_message_t {
-    typedef std::function<aux::encoded_message_t(encoder_t&)> function_type;
+// Partially applied message encoding function. Functions which fit into the inline storage, which is
+// the case for all the messages with a reasonable number of arguments, are not heap allocated.
+
+class unbound_message_t {
+    COCAINE_DECLARE_NONCOPYABLE(unbound_message_t)
+
+    static const size_t kInlineSize = 128;
+
+    struct vtable_t {
+        encoded_message_t (*apply)(void* function, encoder_t& encoder);
+        void (*move)(void* from, void* to);
+        void (*destroy)(void* function);
+    };
+
+    template<class F>
+    struct inlined {
+        static
+        encoded_message_t
+        apply(void* function, encoder_t& encoder) {
+            return (*static_cast<F*>(function))(encoder);
+        }
+
+        static
+        void
+        move(void* from, void* to) {
+            new(to) F(std::move(*static_cast<F*>(from)));
+            static_cast<F*>(from)->~F();
+        }
+
+        static
+        void
+        destroy(void* function) {
+            static_cast<F*>(function)->~F();
+        }
+
+        static const vtable_t vtable;
+    };
+
+    template<class F>
+    struct allocated {
+        static
+        encoded_message_t
+        apply(void* function, encoder_t& encoder) {
+            return (**static_cast<F**>(function))(encoder);
+        }
+
+        static
+        void
+        move(void* from, void* to) {
+            *static_cast<F**>(to) = *static_cast<F**>(from);
+        }
+
+        static
+        void
+        destroy(void* function) {
+            delete *static_cast<F**>(function);
+        }
+
+        static const vtable_t vtable;
+    };
+
+    // Null for the moved-from messages.
+    const vtable_t* m_vtable;
+
+    // Channel the message is sent to, so that it can be scheduled without being encoded.
+    uint64_t m_span;
+
+    mutable std::aligned_storage<kInlineSize>::type m_storage;
+
+public:
+    template<class F>
+    unbound_message_t(uint64_t span, F&& function):
+        m_span(span)
+    {
+        typedef typename std::decay<F>::type function_type;
+
+        construct(std::forward<F>(function),
+            std::integral_constant<bool, sizeof(function_type) <= kInlineSize>());
+    }
+
+    unbound_message_t(unbound_message_t&& other) noexcept:
+        m_vtable(other.m_vtable),
+        m_span(other.m_span)
+    {
+        if(m_vtable) {
+            m_vtable->move(&other.m_storage, &m_storage);
+        }
+
+        other.m_vtable = nullptr;
+    }
+
+    unbound_message_t&
+    operator=(unbound_message_t&& other) noexcept {
+        if(this == &other) {
+            return *this;
+        }
+
+        if(m_vtable) {
+            m_vtable->destroy(&m_storage);
+        }
+
+        if((m_vtable = other.m_vtable) != nullptr) {
+            m_vtable->move(&other.m_storage, &m_storage);
+        }
+
+        other.m_vtable = nullptr;
+
+        m_span = other.m_span;
 
-    // Partially applied message encoding function.
-    const function_type bind;
+        return *this;
+    }
+
+   ~unbound_message_t() {
+        if(m_vtable) {
+            m_vtable->destroy(&m_storage);
+        }
+    }
+
+    uint64_t
+    span() const {
+        return m_span;
+    }
+
+    encoded_message_t
+    apply(encoder_t& encoder) const {
+        BOOST_ASSERT(m_vtable);
+        return m_vtable->apply(&m_storage, encoder);
+    }
 
-    unbound_message_t(function_type&& bind_): bind(std::move(bind_)) { }
+private:
+    template<class F>
+    void
+    construct(F&& function, std::true_type) {
+        typedef typename std::decay<F>::type function_type;
+
+        new(&m_storage) function_type(std::forward<F>(function));
+        m_vtable = &inlined<function_type>::vtable;
+    }
+
+    template<class F>
+    void
+    construct(F&& function, std::false_type) {
+        typedef typename std::decay<F>::type function_type;
+
+        *reinterpret_cast<function_type**>(&m_storage) = new function_type(std::forward<F>(function));
+        m_vtable = &allocated<function_type>::vtable;
+    }
+};
+
+template<class F>
+const unbound_message_t::vtable_t unbound_message_t::inlined<F>::vtable = {
+    &inlined<F>::apply, &inlined<F>::move, &inlined<F>::destroy
+};
+
+template<class F>
+const unbound_message_t::vtable_t unbound_message_t::allocated<F>::vtable = {
+    &allocated<F>::apply, &allocated<F>::move, &allocated<F>::destroy
 };
 
 } // namespace aux
@@ -111,7 +357,14 @@ struct unbound_message_t {
 struct encoder_t {
     COCAINE_DECLARE_NONCOPYABLE(encoder_t)
 
-    encoder_t() = default;
+    encoder_t():
+        huffman_advertise(false),
+        huffman_local(false),
+        huffman_peer(false),
+        extensions_advertise(true),
+        extensions_peer(false)
+    { }
+
    ~encoder_t() = default;
 
     typedef aux::unbound_message_t message_type;
@@ -120,8 +373,10 @@ struct encoder_t {
     template<class Event, class... Args>
     static inline
     aux::encoded_message_t
-    tether(encoder_t& encoder, uint64_t channel_id, Args&... args) {
-        aux::encoded_message_t message;
+    tether(encoder_t& encoder, uint64_t channel_id, uint64_t trace_id, uint64_t span_id,
+           uint64_t parent_id, deadline_t deadline, Args&... args)
+    {
+        aux::encoded_message_t message = encoder.acquire();
 
         msgpack::packer<aux::encoded_buffers_t> packer(message.buffer);
 
@@ -137,40 +392,187 @@ struct encoder_t {
         type_traits<typename event_traits<Event>::argument_type>::pack(packer,
             std::forward<Args>(args)...);
 
-        // Optional message metadata
+        // Optional message metadata. Untraced messages without a deadline don't carry any, except for
+        // the advertisements sent with the first message.
+
+        // NOTE: It's always copied into the buffer, as the header values are packed from temporaries,
+        // including the Huffman coded ones, which would otherwise be referenced if large enough.
+        aux::copied_buffers_t copied(message.buffer);
+        msgpack::packer<aux::copied_buffers_t> metadata(copied);
+
+        const bool traced  = trace_id != trace_t::zero_value;
+        const bool limited = !deadline.empty();
+
+        // NOTE: The peers which haven't advertised the support for the extension table don't know the
+        // compact trace context either, so they get the ids as three separate headers.
+        const size_t trace_headers = traced ? (encoder.extensions_peer ? 1 : 3) : 0;
+
+        metadata.pack_array(trace_headers + limited + encoder.huffman_advertise +
+            encoder.extensions_advertise);
+
+        if(encoder.huffman_advertise) {
+            hpack::msgpack_traits::pack_literal<hpack::headers::huffman_coding<>>(metadata);
+            encoder.huffman_advertise = false;
+        }
+
+        if(encoder.extensions_advertise) {
+            hpack::msgpack_traits::pack_literal<hpack::headers::extension_table<>>(metadata);
+            encoder.extensions_advertise = false;
+        }
+
+        if(limited) {
+            // NOTE: The budget is measured right before the message is sent, so that the time it has
+            // been queued for is accounted for.
+            const uint64_t budget = deadline.remaining().count();
+
+            // NOTE: The peers which haven't advertised the support for the extension table get the
+            // header name as is, as they would misread its index.
+            if(encoder.extensions_peer) {
+                hpack::msgpack_traits::pack_extended<hpack::headers::deadline<>>(metadata,
+                    hpack::header::create_data(budget));
+            } else {
+                hpack::msgpack_traits::pack_literal<hpack::headers::deadline<>>(metadata,
+                    hpack::header::create_data(budget));
+            }
+        }
+
+        if(!traced) {
+            return message;
+        }
+
+        if(!encoder.extensions_peer) {
+            hpack::msgpack_traits::pack_indexed<hpack::headers::trace_id<>>(metadata,
+                hpack::header::create_data(trace_id));
+            hpack::msgpack_traits::pack_indexed<hpack::headers::span_id<>>(metadata,
+                hpack::header::create_data(span_id));
+            hpack::msgpack_traits::pack_indexed<hpack::headers::parent_id<>>(metadata,
+                hpack::header::create_data(parent_id));
+
+            return message;
+        }
+
+        const uint64_t ids[] = { trace_id, span_id, parent_id };
 
-        packer.pack_array(3);
+        char context[sizeof(ids)];
 
-        uint64_t trace_id  = trace_t::current().get_trace_id();
-        uint64_t span_id   = trace_t::current().get_id();
-        uint64_t parent_id = trace_t::current().get_parent_id();
+        // NOTE: The ids are packed in the network byte order, so that the peers agree on them no matter
+        // what their native byte order is.
+        for(size_t i = 0; i < sizeof(context); ++i) {
+            context[i] = static_cast<char>(ids[i / 8] >> (56 - 8 * (i % 8)));
+        }
 
-        hpack::msgpack_traits::pack<hpack::headers::trace_id<>>(packer, encoder.hpack_context, hpack::header::create_data(trace_id));
-        hpack::msgpack_traits::pack<hpack::headers::span_id<>>(packer, encoder.hpack_context, hpack::header::create_data(span_id));
-        hpack::msgpack_traits::pack<hpack::headers::parent_id<>>(packer, encoder.hpack_context, hpack::header::create_data(parent_id));
+        // NOTE: The trace context isn't in the static table, so that the dynamic table indices stay the
+        // same as for the peers which know nothing about it.
+        hpack::msgpack_traits::pack_literal<hpack::headers::trace_context<>>(metadata,
+            hpack::header::create_data(context, sizeof(context)), encoder.huffman());
 
         return message;
     }
 
     aux::encoded_message_t
     encode(const message_type& message) {
-        return message.bind(*this);
+        return message.apply(*this);
+    }
+
+    // Huffman coding of header values. The local support is advertised to the peer with the next
+    // message, but values are only coded once the peer has advertised its own support, so that the
+    // peers which know nothing about it keep working.
+    void
+    enable_huffman() {
+        huffman_advertise = !huffman_local;
+        huffman_local = true;
+    }
+
+    // Called once the peer has advertised its support.
+    void
+    accept_huffman() {
+        huffman_peer = true;
+    }
+
+    bool
+    huffman() const {
+        return huffman_local && huffman_peer;
+    }
+
+    bool
+    huffman_enabled() const {
+        return huffman_local;
+    }
+
+    // The extension table support is always advertised with the first message. Called once the peer
+    // has advertised its own support.
+    void
+    accept_extensions() {
+        extensions_peer = true;
+    }
+
+    bool
+    extensions() const {
+        return extensions_peer;
+    }
+
+    // Takes back the buffer of a message which has been completely sent, so that it could be reused
+    // for the messages encoded later on.
+    void
+    recycle(aux::encoded_message_t&& message) {
+        if(m_buffers.size() >= kMaximumPooledBuffers) {
+            return;
+        }
+
+        if(message.buffer.vector.size() > kMaximumPooledBufferSize) {
+            return;
+        }
+
+        message.buffer.reset();
+
+        m_buffers.emplace_back(std::move(message.buffer));
     }
 
 private:
-    // HPACK HTTP/2.0 tables.
-    hpack::header_table_t hpack_context;
+    aux::encoded_message_t
+    acquire() {
+        if(m_buffers.empty()) {
+            return aux::encoded_message_t(aux::encoded_buffers_t());
+        }
+
+        aux::encoded_message_t message(std::move(m_buffers.back()));
+
+        m_buffers.pop_back();
+
+        return message;
+    }
+
+    static const size_t kMaximumPooledBuffers = 64;
+    static const size_t kMaximumPooledBufferSize = 65536;
+
+    // Buffers of the messages which have been sent already.
+    std::vector<aux::encoded_buffers_t> m_buffers;
+
+    // Huffman coding negotiation state.
+    bool huffman_advertise;
+    bool huffman_local;
+    bool huffman_peer;
+
+    // Extension table negotiation state.
+    bool extensions_advertise;
+    bool extensions_peer;
 };
 
 template<class Event>
 struct encoded:
     public aux::unbound_message_t
 {
+    // NOTE: The trace and the deadline are captured at construction time, as the message is encoded
+    // later on in the reactor thread, where the current ones are unrelated to the message.
     template<class... Args>
-    encoded(uint64_t channel_id, Args&&... args): unbound_message_t(
+    encoded(uint64_t channel_id, Args&&... args): unbound_message_t(channel_id,
         std::bind(&encoder_t::tether<Event, typename std::decay<Args>::type...>,
             std::placeholders::_1,
             channel_id,
+            trace_t::current().get_trace_id(),
+            trace_t::current().get_id(),
+            trace_t::current().get_parent_id(),
+            deadline_t::current(),
             std::forward<Args>(args)...))
     { }
 };
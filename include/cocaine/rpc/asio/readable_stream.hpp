@@ -23,6 +23,8 @@
 
 #include "cocaine/errors.hpp"
 
+#include "cocaine/rpc/asio/buffer_pool.hpp"
+
 #include <functional>
 
 #include <asio/io_service.hpp>
@@ -40,6 +42,10 @@ class readable_stream:
 
     static const size_t kInitialBufferSize = 65536;
 
+    // Frame size hints from the decoder are trusted only up to this limit, because they come from
+    // the remote peer. Larger frames still can be received, but the ring grows gradually for them.
+    static const size_t kMaximumSizeHint = 33554432;
+
     typedef typename Protocol::socket socket_type;
 
     typedef Decoder decoder_type;
@@ -49,20 +55,31 @@ class readable_stream:
 
     typedef std::function<void(const std::error_code&)> handler_type;
 
-    std::vector<char, uninitialized<char>> m_ring;
-    std::vector<char, uninitialized<char>>::size_type m_rd_offset, m_rx_offset;
+    // Optional engine-wide buffer pool. If specified, the ring is borrowed from the pool only while
+    // there is some unprocessed data in it, so idle streams do not occupy any memory.
+    const std::shared_ptr<buffer_pool_t> m_pool;
+
+    buffer_pool_t::buffer_type m_ring;
+    buffer_pool_t::buffer_type::size_type m_rd_offset, m_rx_offset;
 
     decoder_type m_decoder;
 
 public:
     explicit
-    readable_stream(const std::shared_ptr<socket_type>& socket):
-        m_socket(socket)
+    readable_stream(const std::shared_ptr<socket_type>& socket,
+                    const std::shared_ptr<buffer_pool_t>& pool = nullptr):
+        m_socket(socket),
+        m_pool(pool)
     {
-        m_ring.resize(kInitialBufferSize);
         m_rd_offset = m_rx_offset = 0;
     }
 
+   ~readable_stream() {
+        if(m_pool && !m_ring.empty()) {
+            m_pool->release(std::move(m_ring));
+        }
+    }
+
     void
     read(message_type& message, handler_type handle) {
         std::error_code ec;
@@ -79,7 +96,29 @@ public:
             return m_socket->get_io_service().post(std::bind(handle, ec));
         }
 
-        if(m_rx_offset) {
+        namespace ph = std::placeholders;
+
+        if(bytes_pending == 0) {
+            m_rd_offset = m_rx_offset = 0;
+
+            if(m_pool) {
+                if(!m_ring.empty()) {
+                    m_pool->release(std::move(m_ring));
+                    m_ring.clear();
+                }
+
+                // Wait for the socket to become readable without holding any buffer.
+                return m_socket->async_read_some(
+                    asio::null_buffers(),
+                    std::bind(&readable_stream::ready, this->shared_from_this(), std::ref(message), handle, ph::_1)
+                );
+            }
+
+            if(m_ring.size() > kInitialBufferSize) {
+                // The ring has been grown during some burst and is drained now, so shrink it back.
+                buffer_pool_t::buffer_type(kInitialBufferSize).swap(m_ring);
+            }
+        } else if(m_rx_offset) {
             // Compactify the ring before the asynchronous read operation.
             std::memmove(m_ring.data(), m_ring.data() + m_rx_offset, bytes_pending);
 
@@ -87,26 +126,99 @@ public:
             m_rx_offset = 0;
         }
 
-        if(bytes_pending * 2 >= m_ring.size()) {
+        if(m_ring.empty()) {
+            // NOTE: The ring is only allocated by the first read, which happens on the reactor thread
+            // rather than on the thread the stream has been created by, so that the memory ends up
+            // on the reactor's NUMA node, if it's pinned.
+            m_ring.resize(kInitialBufferSize);
+        }
+
+        const size_t bytes_required = m_decoder.required();
+
+        if(bytes_required > m_ring.size() && bytes_required <= kMaximumSizeHint) {
+            // The decoder already knows that the pending frame is larger than the ring, so grow the
+            // ring right to the frame size at once instead of doubling it over and over again.
+            size_t size = m_ring.size();
+
+            while(size < bytes_required) {
+                size *= 2;
+            }
+
+            m_ring.resize(size);
+        } else if(bytes_pending * 2 >= m_ring.size()) {
             // The total size of unprocessed data in larger than half the size of the ring, so grow
             // the ring in order to accomodate more data.
             m_ring.resize(m_ring.size() * 2);
         }
 
-        namespace ph = std::placeholders;
-
         m_socket->async_read_some(
             asio::buffer(m_ring.data() + m_rd_offset, m_ring.size() - m_rd_offset),
             std::bind(&readable_stream::fill, this->shared_from_this(), std::ref(message), handle, ph::_1, ph::_2)
         );
     }
 
+    // Synchronously decodes the next message if it's already buffered. Returns false if there is no
+    // complete message in the ring or it can't be decoded, in which case read() should be used to
+    // either wait for more data or report the error.
+    bool
+    try_read(message_type& message) {
+        if(m_rd_offset == m_rx_offset) {
+            return false;
+        }
+
+        std::error_code ec;
+
+        const size_t
+            bytes_pending = m_rd_offset - m_rx_offset,
+            bytes_decoded = m_decoder.decode(m_ring.data() + m_rx_offset, bytes_pending, message, ec);
+
+        if(ec) {
+            return false;
+        }
+
+        m_rx_offset += bytes_decoded;
+
+        return true;
+    }
+
     auto
     pressure() const -> size_t {
         return m_ring.size();
     }
 
+    auto
+    pool() const -> const std::shared_ptr<buffer_pool_t>& {
+        return m_pool;
+    }
+
 private:
+    void
+    ready(message_type& message, handler_type handle, const std::error_code& ec) {
+        if(ec) {
+            if(ec == asio::error::operation_aborted) {
+                return;
+            }
+
+            return m_socket->get_io_service().post(std::bind(handle, ec));
+        }
+
+        if(m_ring.empty()) {
+            m_ring = m_pool->acquire();
+        }
+
+        std::error_code error;
+
+        // The socket is in non-blocking mode, so this won't block even on spurious wakeups.
+        const size_t bytes_read = m_socket->read_some(asio::buffer(m_ring.data(), m_ring.size()), error);
+
+        if(error == asio::error::would_block || error == asio::error::try_again) {
+            // Nothing has been read, so return the buffer and go back to waiting.
+            return read(message, handle);
+        }
+
+        fill(message, handle, error, bytes_read);
+    }
+
     void
     fill(message_type& message, handler_type handle, const std::error_code& ec, size_t bytes_read) {
         if(ec) {
@@ -37,9 +37,9 @@ struct transport {
     typedef typename protocol_type::socket socket_type;
 
     explicit
-    transport(std::unique_ptr<socket_type> socket_):
+    transport(std::unique_ptr<socket_type> socket_, const std::shared_ptr<buffer_pool_t>& pool = nullptr):
         socket(std::move(socket_)),
-        reader(new readable_stream<protocol_type, decoder_type>(socket)),
+        reader(new readable_stream<protocol_type, decoder_type>(socket, pool)),
         writer(new writable_stream<protocol_type, encoder_type>(socket))
     {
         socket->non_blocking(true);
@@ -49,10 +49,22 @@ struct transport {
     template<class OtherProtocol>
     transport(transport<OtherProtocol, encoder_type, decoder_type>&& other):
         socket(new socket_type(std::move(*other.socket))),
-        reader(new readable_stream<protocol_type, decoder_type>(socket)),
+        reader(new readable_stream<protocol_type, decoder_type>(socket, other.reader->pool())),
         writer(new writable_stream<protocol_type, encoder_type>(socket))
     {
         // The socket is already in non-blocking mode.
+
+        if(const auto& corking = other.writer->corking()) {
+            writer->cork(*corking);
+        }
+
+        if(const auto& watermarks = other.writer->watermarks()) {
+            writer->bound(*watermarks);
+        }
+
+        if(other.writer->huffman()) {
+            writer->enable_huffman();
+        }
     }
 
    ~transport() {
@@ -28,11 +28,32 @@
 
 #include <asio/io_service.hpp>
 #include <asio/basic_stream_socket.hpp>
+#include <asio/deadline_timer.hpp>
 
+#include <boost/optional.hpp>
+
+#include <atomic>
 #include <deque>
+#include <iterator>
+#include <unordered_map>
+#include <vector>
 
 namespace cocaine { namespace io {
 
+// Write coalescing settings. When enabled, messages are held until either the amount of pending
+// data reaches the threshold, the latency bound expires or the current reactor turn is over.
+struct corking_t {
+    size_t bytes;
+    boost::posix_time::milliseconds latency;
+};
+
+// Write queue bounds. Once the amount of pending data reaches the high watermark, the stream stays
+// congested until it is drained down to the low watermark.
+struct watermarks_t {
+    size_t high;
+    size_t low;
+};
+
 template<class Protocol, class Encoder>
 class writable_stream:
     public std::enable_shared_from_this<writable_stream<Protocol, Encoder>>
@@ -48,43 +69,352 @@ class writable_stream:
 
     typedef std::function<void(const std::error_code&)> handler_type;
 
+    static const size_t kCompactionThreshold = 64;
+
+    // Maximum amount of data committed to the outgoing buffer segments ahead of the socket. Messages
+    // beyond that wait in their channel lanes, so that the order they are sent in can still change.
+    static const size_t kSchedulingWindow = 262144;
+
+    // Amount of data every channel lane might commit per scheduling round.
+    static const size_t kQuantum = 65536;
+
+    // Outgoing buffer segments, possibly several for every message.
     std::deque<asio::const_buffer> m_messages;
-    std::deque<typename Encoder::encoded_message_type> m_encoded_messages;
-    std::deque<handler_type> m_handlers;
 
-    enum class states { idle, flushing } m_state;
+    struct pending_t {
+        // NOTE: The source message is kept alive until it's sent, as the encoder doesn't copy large
+        // message arguments. Moving it around is fine, since such arguments are heap allocated.
+        message_type source;
+        typename encoder_type::encoded_message_type encoded;
+
+        // Number of segments left to send.
+        size_t segments;
+
+        // Might be empty, in which case nothing is posted once the message is sent.
+        handler_type handler;
+    };
+
+    // Messages which are not completely sent yet start at the head. The queue storage is reused, so
+    // that writes don't allocate in the steady state.
+    std::vector<pending_t> m_pending;
+    size_t m_head;
+
+    // Amount of committed data which is not yet written.
+    size_t m_committed;
+
+    struct lane_t {
+        std::deque<pending_t> queue;
+
+        // Amount of data the lane might still commit in the current round.
+        size_t deficit;
+    };
+
+    // Messages which are not committed yet, queued per channel, and the round robin order of the
+    // channels which have any. Only used while there's a backlog, as the messages are committed right
+    // away otherwise.
+    std::unordered_map<uint64_t, lane_t> m_lanes;
+    std::deque<uint64_t> m_schedule;
+
+    // Whether the lane at the front of the schedule has already got its quantum in this round.
+    bool m_granted;
+
+    enum class states { idle, corked, flushing } m_state;
+
+    // Optional write coalescing settings.
+    boost::optional<corking_t> m_corking;
+    std::unique_ptr<asio::deadline_timer> m_timer;
+
+    // Amount of data gathered since the stream has been corked.
+    size_t m_corked_bytes;
+
+    // Corking round number, so that the uncork handlers of the earlier rounds, which might still be
+    // queued after their batch has already been sent, can't flush the current batch early.
+    uint64_t m_round;
+
+    // Optional write queue bounds.
+    boost::optional<watermarks_t> m_watermarks;
+
+    // Amount of data queued but not yet written, observable from other threads.
+    std::atomic<size_t> m_pending_bytes;
+    std::atomic<bool> m_congested;
+
+    // Handlers to call once the congested stream is drained.
+    std::vector<std::function<void()>> m_drain_handlers;
+
+    std::atomic<uint64_t> m_messages_written;
+    std::atomic<uint64_t> m_syscalls;
 
     encoder_type encoder;
 
 public:
+    struct stats_t {
+        // Number of messages queued for writing.
+        uint64_t messages;
+
+        // Number of write system calls issued.
+        uint64_t syscalls;
+    };
+
     explicit
     writable_stream(const std::shared_ptr<socket_type>& socket):
         m_socket(socket),
-        m_state(states::idle)
+        m_head(0),
+        m_committed(0),
+        m_granted(false),
+        m_state(states::idle),
+        m_corked_bytes(0),
+        m_round(0),
+        m_pending_bytes(0),
+        m_congested(false),
+        m_messages_written(0),
+        m_syscalls(0)
     { }
 
+    // Enables write coalescing. Must be called before any writes.
+    void
+    cork(const corking_t& corking) {
+        m_corking = corking;
+
+        if(corking.latency.total_milliseconds()) {
+            m_timer = std::make_unique<asio::deadline_timer>(m_socket->get_io_service());
+        }
+    }
+
+    // Enables write queue bounds. Must be called before any writes.
+    void
+    bound(const watermarks_t& watermarks) {
+        m_watermarks = watermarks;
+    }
+
+    // Enables Huffman coding of the header values, once the peer advertises its support for it as
+    // well. Must be called before any writes.
     void
-    write(const message_type& message, handler_type handle) {
-        size_t bytes_written = 0;
+    enable_huffman() {
+        encoder.enable_huffman();
+    }
+
+    // Called once the peer has advertised its support for Huffman coded header values.
+    void
+    accept_huffman() {
+        encoder.accept_huffman();
+    }
+
+    bool
+    huffman() const {
+        return encoder.huffman_enabled();
+    }
+
+    // Whether the peer's advertisement is still of any interest, i.e. Huffman coding is enabled
+    // locally, but the peer hasn't advertised its support for it yet.
+    bool
+    huffman_pending() const {
+        return encoder.huffman_enabled() && !encoder.huffman();
+    }
+
+    // Called once the peer has advertised its support for the extension table.
+    void
+    accept_extensions() {
+        encoder.accept_extensions();
+    }
 
+    // Calls the handler as soon as the stream is not congested. Must be called on the stream's
+    // reactor thread.
+    void
+    notify(std::function<void()> handler) {
+        if(!m_congested) {
+            return m_socket->get_io_service().post(handler);
+        }
+
+        m_drain_handlers.emplace_back(std::move(handler));
+    }
+
+    // NOTE: Messages of the same channel are always sent in the order they are written, but large
+    // messages don't hold back the messages of the other channels written after them: once there's a
+    // backlog, channels take turns to send their messages.
+    void
+    write(message_type&& message, handler_type handle) {
         auto encoded = encoder.encode(message);
 
-        if(m_state == states::idle) {
-            std::error_code ec;
+        m_corked_bytes += encoded.size();
+        m_pending_bytes += encoded.size();
+
+        if(m_watermarks && m_pending_bytes >= m_watermarks->high) {
+            m_congested = true;
+        }
+
+        pending_t pending{std::move(message), std::move(encoded), 0, std::move(handle)};
+
+        if(m_schedule.empty() && m_committed < kSchedulingWindow) {
+            commit(std::move(pending));
+        } else {
+            enqueue(std::move(pending));
+        }
+
+        m_messages_written++;
 
-            // Try to write some data right away, as we don't have anything pending.
-            bytes_written = m_socket->write_some(asio::buffer(encoded.data(), encoded.size()), ec);
+        switch(m_state) {
+        case states::flushing:
+            return;
+        case states::idle:
+            if(m_corking && m_corked_bytes < m_corking->bytes) {
+                return schedule();
+            }
 
-            if(!ec && bytes_written == encoded.size()) {
-                return m_socket->get_io_service().post(trace_t::bind(handle, ec));
+            break;
+        case states::corked:
+            if(m_corked_bytes < m_corking->bytes) {
+                return;
             }
+
+            if(m_timer) {
+                m_timer->cancel();
+            }
+
+            break;
         }
 
-        m_messages.emplace_back(encoded.data() + bytes_written, encoded.size() - bytes_written);
-        m_handlers.emplace_back(handle);
-        m_encoded_messages.emplace_back(std::move(encoded));
+        send();
+    }
+
+    // Amount of queued data, including the large message arguments referenced by the encoder.
+    auto
+    pressure() const -> size_t {
+        return m_pending_bytes;
+    }
+
+    bool
+    congested() const {
+        return m_congested;
+    }
+
+    auto
+    watermarks() const -> const boost::optional<watermarks_t>& {
+        return m_watermarks;
+    }
+
+    auto
+    corking() const -> const boost::optional<corking_t>& {
+        return m_corking;
+    }
+
+    auto
+    stats() const -> stats_t {
+        return stats_t{m_messages_written, m_syscalls};
+    }
+
+private:
+    void
+    commit(pending_t&& pending) {
+        const size_t segments = m_messages.size();
+
+        // All the segments are sent with a single gathering write operation.
+        pending.encoded.buffers(std::back_inserter(m_messages));
+        pending.segments = m_messages.size() - segments;
+
+        m_committed += pending.encoded.size();
+
+        m_pending.push_back(std::move(pending));
+    }
+
+    void
+    enqueue(pending_t&& pending) {
+        const auto span = pending.source.span();
 
-        if(m_state == states::flushing) {
+        lane_t& lane = m_lanes[span];
+
+        if(lane.queue.empty()) {
+            lane.deficit = 0;
+            m_schedule.push_back(span);
+        }
+
+        lane.queue.push_back(std::move(pending));
+    }
+
+    // Commits the queued messages up to the scheduling window, with deficit round robin over the
+    // channel lanes, so that every channel gets its fair share of the bandwidth.
+    void
+    refill() {
+        while(!m_schedule.empty() && m_committed < kSchedulingWindow) {
+            const auto it = m_lanes.find(m_schedule.front());
+
+            lane_t& lane = it->second;
+
+            if(!m_granted) {
+                lane.deficit += kQuantum;
+                m_granted = true;
+            }
+
+            const size_t size = lane.queue.front().encoded.size();
+
+            if(size > lane.deficit) {
+                // NOTE: Messages larger than the quantum are committed once the lane has saved up
+                // enough over several rounds.
+                m_schedule.push_back(m_schedule.front());
+                m_schedule.pop_front();
+                m_granted = false;
+                continue;
+            }
+
+            lane.deficit -= size;
+
+            commit(std::move(lane.queue.front()));
+            lane.queue.pop_front();
+
+            if(lane.queue.empty()) {
+                m_lanes.erase(it);
+                m_schedule.pop_front();
+                m_granted = false;
+            }
+        }
+    }
+
+    void
+    schedule() {
+        m_state = states::corked;
+
+        // NOTE: Corked streams don't keep themselves alive, so the pending messages are dropped along
+        // with the transport, just like it happens with the aborted asynchronous writes.
+        std::weak_ptr<writable_stream> weak(this->shared_from_this());
+
+        const uint64_t round = ++m_round;
+
+        auto uncork = [weak, round](const std::error_code& ec) {
+            if(ec == asio::error::operation_aborted) {
+                return;
+            }
+
+            if(auto self = weak.lock()) {
+                if(self->m_state == states::corked && self->m_round == round) self->send();
+            }
+        };
+
+        if(m_timer) {
+            m_timer->expires_from_now(m_corking->latency);
+            m_timer->async_wait(uncork);
+        } else {
+            m_socket->get_io_service().post(std::bind(uncork, std::error_code()));
+        }
+    }
+
+    void
+    send() {
+        m_corked_bytes = 0;
+
+        std::error_code ec;
+
+        // Try to write some data right away, as we don't have anything in flight.
+        const size_t bytes_written = m_socket->write_some(m_messages, ec);
+
+        m_syscalls++;
+
+        if(!ec) {
+            consume(bytes_written);
+        }
+
+        refill();
+
+        if(m_messages.empty()) {
+            m_state = states::idle;
             return;
         } else {
             m_state = states::flushing;
@@ -98,12 +428,6 @@ public:
         );
     }
 
-    auto
-    pressure() const -> size_t {
-        return asio::buffer_size(m_messages);
-    }
-
-private:
     void
     flush(const std::error_code& ec, size_t bytes_written) {
         if(ec) {
@@ -111,36 +435,40 @@ private:
                 return;
             }
 
-            while(!m_handlers.empty()) {
-                m_socket->get_io_service().post(std::bind(m_handlers.front(), ec));
-
-                m_messages.pop_front();
-                m_handlers.pop_front();
-                m_encoded_messages.pop_front();
+            for(auto it = m_pending.begin() + m_head; it != m_pending.end(); ++it) {
+                if(it->handler) {
+                    m_socket->get_io_service().post(std::bind(std::move(it->handler), ec));
+                }
             }
 
-            return;
-        }
+            for(auto lane = m_lanes.begin(); lane != m_lanes.end(); ++lane) {
+                for(auto it = lane->second.queue.begin(); it != lane->second.queue.end(); ++it) {
+                    if(it->handler) {
+                        m_socket->get_io_service().post(std::bind(std::move(it->handler), ec));
+                    }
+                }
+            }
 
-        while(bytes_written) {
-            BOOST_ASSERT(!m_messages.empty() && !m_handlers.empty());
+            m_messages.clear();
+            m_pending.clear();
+            m_head = 0;
+            m_committed = 0;
 
-            const size_t message_size = asio::buffer_size(m_messages.front());
+            m_lanes.clear();
+            m_schedule.clear();
+            m_granted = false;
 
-            if(message_size > bytes_written) {
-                m_messages.front() = m_messages.front() + bytes_written;
-                break;
-            }
+            // The stream is dead anyway, so there's nothing to wait for.
+            m_drain_handlers.clear();
+            m_pending_bytes = 0;
 
-            bytes_written -= message_size;
+            return;
+        }
 
-            // Queue this block's handler for invocation.
-            m_socket->get_io_service().post(std::bind(m_handlers.front(), ec));
+        m_syscalls++;
 
-            m_messages.pop_front();
-            m_handlers.pop_front();
-            m_encoded_messages.pop_front();
-        }
+        consume(bytes_written);
+        refill();
 
         if(m_messages.empty() && m_state == states::flushing) {
             m_state = states::idle;
@@ -154,6 +482,65 @@ private:
             std::bind(&writable_stream::flush, this->shared_from_this(), ph::_1, ph::_2)
         );
     }
+
+    void
+    consume(size_t bytes_written) {
+        m_pending_bytes -= bytes_written;
+        m_committed -= bytes_written;
+
+        if(m_congested && m_pending_bytes <= m_watermarks->low) {
+            m_congested = false;
+
+            for(auto it = m_drain_handlers.begin(); it != m_drain_handlers.end(); ++it) {
+                m_socket->get_io_service().post(*it);
+            }
+
+            m_drain_handlers.clear();
+        }
+
+        while(bytes_written) {
+            BOOST_ASSERT(!m_messages.empty() && m_head < m_pending.size());
+
+            const size_t segment_size = asio::buffer_size(m_messages.front());
+
+            if(segment_size > bytes_written) {
+                m_messages.front() = m_messages.front() + bytes_written;
+                break;
+            }
+
+            bytes_written -= segment_size;
+
+            m_messages.pop_front();
+
+            pending_t& pending = m_pending[m_head];
+
+            if(--pending.segments) {
+                continue;
+            }
+
+            // Queue this message's handler for invocation.
+            if(pending.handler) {
+                m_socket->get_io_service().post(std::bind(std::move(pending.handler), std::error_code()));
+            }
+
+            encoder.recycle(std::move(pending.encoded));
+
+            // NOTE: The sent message and its handler are released right away, as the slot itself might
+            // stay in the queue until the queue is drained or compacted.
+            const message_type sent(std::move(pending.source));
+
+            pending.handler = nullptr;
+
+            if(++m_head == m_pending.size()) {
+                m_pending.clear();
+                m_head = 0;
+            } else if(m_head >= kCompactionThreshold && m_head * 2 >= m_pending.size()) {
+                // Never drained completely, so drop the sent messages to keep the queue bounded.
+                m_pending.erase(m_pending.begin(), m_pending.begin() + m_head);
+                m_head = 0;
+            }
+        }
+    }
 };
 
 }} // namespace cocaine::io
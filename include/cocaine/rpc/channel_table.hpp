@@ -0,0 +1,220 @@
+/*
+    Copyright (c) 2011-2015 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_IO_CHANNEL_TABLE_HPP
+#define COCAINE_IO_CHANNEL_TABLE_HPP
+
+#include "cocaine/common.hpp"
+
+#include <random>
+
+namespace cocaine { namespace io {
+
+// Open-addressed hash table for the session channels, keyed by channel id. Lookups, insertions and
+// removals cost the same no matter how many channels are there, and since all the slots are stored
+// in a single flat array, a lookup normally touches a single cache line. Valid channel ids start
+// from 1, so zero is used to mark empty slots and is never found in the table.
+//
+// Channel ids are chosen by the clients, so the keys are mixed with a random seed of every table.
+// Otherwise a client could pick the ids which all land in the same slot, turning every lookup into
+// a scan over all of its channels.
+
+template<class T>
+class channel_table {
+    static const size_t kInitialCapacity = 16;
+
+    struct slot_t {
+        uint64_t key;
+        T value;
+    };
+
+    std::vector<slot_t> m_slots;
+    size_t m_size;
+
+    const uint64_t m_seed;
+
+public:
+    typedef uint64_t key_type;
+    typedef T mapped_type;
+
+    channel_table():
+        m_slots(kInitialCapacity),
+        m_size(0),
+        m_seed(seed())
+    { }
+
+    auto
+    find(key_type key) -> T* {
+        if(key == 0) {
+            return nullptr;
+        }
+
+        for(size_t i = index(key);; i = next(i)) {
+            if(m_slots[i].key == key) {
+                return &m_slots[i].value;
+            } else if(m_slots[i].key == 0) {
+                return nullptr;
+            }
+        }
+    }
+
+    // Returns the existing value if the key is already in the table.
+    auto
+    insert(key_type key, T value) -> T& {
+        BOOST_ASSERT(key != 0);
+
+        if((m_size + 1) * 2 > m_slots.size()) {
+            // Keep the load factor below 1/2, so that probe sequences stay short.
+            rehash(m_slots.size() * 2);
+        }
+
+        size_t i = index(key);
+
+        for(; m_slots[i].key != 0; i = next(i)) {
+            if(m_slots[i].key == key) {
+                return m_slots[i].value;
+            }
+        }
+
+        m_slots[i].key = key;
+        m_slots[i].value = std::move(value);
+        m_size++;
+
+        return m_slots[i].value;
+    }
+
+    bool
+    erase(key_type key) {
+        if(key == 0) {
+            return false;
+        }
+
+        size_t i = index(key);
+
+        while(m_slots[i].key != key) {
+            if(m_slots[i].key == 0) {
+                return false;
+            }
+
+            i = next(i);
+        }
+
+        // NOTE: Shift the following entries of the probe sequence back instead of leaving tombstones
+        // behind, so that lookups never slow down no matter how many channels have been revoked.
+        for(size_t j = next(i); m_slots[j].key != 0; j = next(j)) {
+            const size_t home = index(m_slots[j].key);
+
+            // Move the entry only if the hole lies on its probe sequence, i.e. cyclically in between
+            // its home slot and its current position.
+            if(((j - home) & mask()) >= ((j - i) & mask())) {
+                m_slots[i] = std::move(m_slots[j]);
+                i = j;
+            }
+        }
+
+        m_slots[i].key = 0;
+        m_slots[i].value = T();
+        m_size--;
+
+        if(m_slots.size() > kInitialCapacity && m_size * 8 < m_slots.size()) {
+            // Give the memory back after a burst of channels is over.
+            rehash(m_slots.size() / 2);
+        }
+
+        return true;
+    }
+
+    template<class F>
+    void
+    for_each(F&& functor) const {
+        for(auto it = m_slots.begin(); it != m_slots.end(); ++it) {
+            if(it->key != 0) functor(it->key, it->value);
+        }
+    }
+
+    void
+    clear() {
+        std::vector<slot_t>(kInitialCapacity).swap(m_slots);
+        m_size = 0;
+    }
+
+    size_t
+    size() const {
+        return m_size;
+    }
+
+    bool
+    empty() const {
+        return m_size == 0;
+    }
+
+private:
+    size_t
+    mask() const {
+        return m_slots.size() - 1;
+    }
+
+    size_t
+    index(key_type key) const {
+        // NOTE: The splitmix64 finalizer, so that every bit of the seeded key affects the slot.
+        key ^= m_seed;
+        key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ull;
+        key = (key ^ (key >> 27)) * 0x94d049bb133111ebull;
+
+        return static_cast<size_t>(key ^ (key >> 31)) & mask();
+    }
+
+    static
+    uint64_t
+    seed() {
+        static thread_local std::mt19937_64 generator(std::random_device{}());
+        return generator();
+    }
+
+    size_t
+    next(size_t i) const {
+        return (i + 1) & mask();
+    }
+
+    void
+    rehash(size_t capacity) {
+        std::vector<slot_t> slots(capacity);
+
+        slots.swap(m_slots);
+
+        for(auto it = slots.begin(); it != slots.end(); ++it) {
+            if(it->key == 0) {
+                continue;
+            }
+
+            size_t i = index(it->key);
+
+            while(m_slots[i].key != 0) {
+                i = next(i);
+            }
+
+            m_slots[i] = std::move(*it);
+        }
+    }
+};
+
+}} // namespace cocaine::io
+
+#endif
@@ -0,0 +1,92 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_IO_DEADLINE_HPP
+#define COCAINE_IO_DEADLINE_HPP
+
+#include <chrono>
+#include <cstdint>
+
+namespace cocaine { namespace io {
+
+// Invocation deadline. Clients limit the time they are willing to wait for an invocation with the
+// deadline header, which carries the remaining time budget. Sessions drop invocations which arrive
+// already expired, and set the current deadline while the invocation is being handled, so that the
+// slots can check the remaining budget. The deadline is forwarded with the messages sent to the
+// channels forked while it's set.
+
+class deadline_t {
+public:
+    typedef std::chrono::steady_clock clock_type;
+
+    class scope_t;
+
+    // Construct an empty deadline, i.e. no time limit.
+    constexpr
+    deadline_t():
+        expiry(0)
+    { }
+
+    static
+    deadline_t
+    after(std::chrono::microseconds budget);
+
+    // Deadline of the invocation being handled by the calling thread.
+    static
+    deadline_t&
+    current();
+
+    bool
+    empty() const {
+        return expiry == 0;
+    }
+
+    bool
+    expired() const;
+
+    // Remaining time budget. Zero if the deadline has expired, the maximum duration if it's empty.
+    std::chrono::microseconds
+    remaining() const;
+
+private:
+    // Microseconds since the clock epoch.
+    int64_t expiry;
+};
+
+class deadline_t::scope_t {
+public:
+    explicit
+    scope_t(const deadline_t& deadline):
+        previous(current())
+    {
+        current() = deadline;
+    }
+
+   ~scope_t() {
+        current() = previous;
+    }
+
+private:
+    const deadline_t previous;
+};
+
+}} // namespace cocaine::io
+
+#endif
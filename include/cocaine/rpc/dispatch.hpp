@@ -26,6 +26,7 @@
 
 #include "cocaine/rpc/slot/blocking.hpp"
 #include "cocaine/rpc/slot/deferred.hpp"
+#include "cocaine/rpc/slot/offload.hpp"
 #include "cocaine/rpc/slot/streamed.hpp"
 
 #include "cocaine/rpc/traversal.hpp"
@@ -135,6 +136,11 @@ public:
     dispatch&
     on(const F& callable, typename boost::disable_if<is_slot<F, Event>>::type* = nullptr);
 
+    // Runs the callable on a worker pool, see io::offload_slot.
+    template<class Event, class F>
+    dispatch&
+    on(const F& callable, const io::offload& policy);
+
     template<class Event>
     dispatch&
     on(const std::shared_ptr<io::basic_slot<Event>>& ptr);
@@ -238,6 +244,19 @@ dispatch<Tag>::on(const F& callable, typename boost::disable_if<is_slot<F, Event
     return on<Event>(std::make_shared<slot_type>(callable));
 }
 
+template<class Tag>
+template<class Event, class F>
+dispatch<Tag>&
+dispatch<Tag>::on(const F& callable, const io::offload& policy) {
+    static_assert(
+        std::is_same<typename aux::select<typename result_of<F>::type, Event>::type,
+                     io::blocking_slot<Event>>::value,
+        "only blocking callables can be offloaded"
+    );
+
+    return on<Event>(std::make_shared<io::offload_slot<Event>>(callable, policy.pool));
+}
+
 template<class Tag>
 template<class Event>
 dispatch<Tag>&
@@ -26,11 +26,26 @@
 
 #include <asio/generic/stream_protocol.hpp>
 
+#include <atomic>
+#include <deque>
+#include <type_traits>
+
 #include "cocaine/rpc/asio/encoder.hpp"
 #include "cocaine/rpc/asio/decoder.hpp"
 
+#include "cocaine/rpc/channel_table.hpp"
+
+#include "cocaine/trace/recorder.hpp"
+
 namespace cocaine {
 
+namespace io {
+
+class admission_t;
+struct load_t;
+
+} // namespace io
+
 class session_t:
     public std::enable_shared_from_this<session_t>
 {
@@ -40,11 +55,11 @@ class session_t:
     typedef io::transport<protocol_type> transport_type;
 
     class pull_action_t;
-    class push_action_t;
+    class drain_action_t;
 
     class channel_t;
 
-    typedef std::map<uint64_t, std::shared_ptr<channel_t>> channel_map_t;
+    typedef io::channel_table<std::shared_ptr<channel_t>> channel_map_t;
 
     // Log of last resort.
     const std::unique_ptr<logging::log_t> log;
@@ -62,12 +77,51 @@ class session_t:
     // Virtual channels.
     synchronized<channel_map_t> channels;
 
+    struct outgoing_t {
+        io::encoder_t::message_type message;
+
+        // Only set for traced messages, so that their completion is logged under their own trace.
+        std::function<void(const std::error_code&)> handler;
+    };
+
+    // Outgoing messages are queued by the producers and written in batches on the reactor thread.
+    // The queues are swapped on every batch, so that their storage is reused.
+    synchronized<std::vector<outgoing_t>> outbox;
+    std::vector<outgoing_t> draining;
+
+    // Memory for the scheduled batch operation, so that scheduling it doesn't touch the heap.
+    std::aligned_storage<128>::type drain_storage;
+    std::atomic<bool> drain_storage_used;
+
     // The maximum channel id processed by the session. Checking whether channel id is always higher
     // than the previous channel id is similar to an infinite TIME_WAIT timeout for TCP sockets. It
     // might be not the best approach, but since we have 2^64 possible channel ids, and not 2^16 TCP
     // ports available to us, it's good enough.
     uint64_t max_channel_id;
 
+    // Admission controller for the new invocations, if load shedding is enabled for the service.
+    // Only used on the reactor thread.
+    std::shared_ptr<io::admission_t> admission;
+
+    // Quotas the incoming channels and messages are accounted in: the session's own one and the one
+    // shared by all the sessions of the same remote address, if configured.
+    std::vector<std::shared_ptr<io::quota_t>> quotas;
+
+    // Load of the engine the session is attached to, which the session and its incoming channels
+    // are accounted in.
+    std::shared_ptr<io::load_t> load;
+
+    // Ranges of the channel ids which invocations have been rejected before being handled, in the
+    // ascending order. Consecutive rejections share a range, so sustained shedding takes just one.
+    std::deque<std::pair<uint64_t, uint64_t>> rejected;
+
+    static const size_t kMaximumRejectedRanges = 1024;
+
+    // Span recorder for the traced messages, they are logged if there's none. The endpoint is the
+    // interned session name the spans are attributed to.
+    span_recorder_t* recorder;
+    trace_t::name_t endpoint;
+
 public:
     session_t(std::unique_ptr<logging::log_t> log,
               std::unique_ptr<transport_type> transport, const io::dispatch_ptr_t& prototype);
@@ -80,6 +134,11 @@ public:
     std::size_t
     memory_pressure() const;
 
+    // NOTE: Sessions with pooled read buffers report no memory pressure while idle, so use this to
+    // tell whether the connection is actually gone.
+    bool
+    is_detached() const;
+
     auto
     name() const -> std::string;
 
@@ -88,12 +147,30 @@ public:
 
     // Modifiers
 
+    // NOTE: Must be called before the session is started.
+    void
+    regulate(const std::shared_ptr<io::admission_t>& admission);
+
+    // NOTE: Must be called before the session is started.
+    void
+    record(span_recorder_t& recorder);
+
+    // NOTE: Must be called before the session is started.
+    void
+    limit(const std::shared_ptr<io::quota_t>& quota);
+
+    // NOTE: Must be called before the session is started.
+    void
+    account(const std::shared_ptr<io::load_t>& load);
+
     auto
     fork(const io::dispatch_ptr_t& dispatch) -> io::upstream_ptr_t;
 
     void
     pull();
 
+    // NOTE: Throws queue_overflow if the client doesn't keep up with the messages already queued for
+    // it, so that streaming producers fail fast instead of exhausting the memory.
     void
     push(io::encoder_t::message_type&& message);
 
@@ -109,6 +186,28 @@ private:
     void
     handle(const io::decoder_t::message_type& message);
 
+    void
+    finalize(const std::error_code& ec);
+
+    void
+    annotate(span_recorder_t::annotation_t annotation);
+
+    // Whether the invocations of the specified type can be rejected, which is only possible if the
+    // slot's upstream protocol has the conventional error message to send on its behalf.
+    bool
+    rejectable(uint64_t type) const;
+
+    void
+    reject(uint64_t channel_id, uint64_t type, const std::error_code& ec);
+
+    // Accounts for a new incoming channel in all the quotas and the engine load, unless any of the
+    // quotas is exhausted.
+    bool
+    acquire();
+
+    void
+    release(size_t count);
+
     // NOTE: The revocation happens to channel id only, not the upstream itself. It means that while
     // some channel might be revoked during message handling, it only prohibit new incoming messages
     // from being processed, but shared upstreams still can be used by services to send new outgoing
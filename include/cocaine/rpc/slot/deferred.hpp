@@ -24,6 +24,9 @@
 #include "cocaine/rpc/slot/function.hpp"
 
 #include "cocaine/rpc/queue.hpp"
+#include "cocaine/rpc/string_ref.hpp"
+
+#include <boost/mpl/contains.hpp>
 
 namespace cocaine { namespace io {
 
@@ -43,6 +46,11 @@ struct deferred_slot:
     typedef typename parent_type::upstream_type upstream_type;
     typedef typename parent_type::protocol      protocol;
 
+    static_assert(
+        !boost::mpl::contains<typename basic_slot<Event>::sequence_type, string_ref_t>::value,
+        "referenced arguments are only allowed in blocking slots"
+    );
+
     explicit
     deferred_slot(callable_type callable):
         parent_type(callable)
@@ -0,0 +1,153 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_IO_OFFLOAD_SLOT_HPP
+#define COCAINE_IO_OFFLOAD_SLOT_HPP
+
+#include "cocaine/rpc/slot/blocking.hpp"
+
+#include "cocaine/rpc/deadline.hpp"
+#include "cocaine/rpc/string_ref.hpp"
+#include "cocaine/rpc/worker_pool.hpp"
+
+#include "cocaine/trace/trace.hpp"
+
+#include <boost/mpl/contains.hpp>
+
+namespace cocaine { namespace io {
+
+// Slot policy for dispatch<Tag>::on(). Callables which might block or take long to complete are run
+// on the specified worker pool instead of the engine thread, replies are sent from the pool.
+
+struct offload {
+    explicit
+    offload(const std::shared_ptr<worker_pool_t>& pool_):
+        pool(pool_)
+    { }
+
+    const std::shared_ptr<worker_pool_t> pool;
+};
+
+namespace aux {
+
+// Reports the invocations which have never been run to the client, unless the slot is mute.
+
+template<class Event, class R>
+struct offload_error {
+    typedef typename blocking_slot<Event, R>::protocol protocol;
+
+    template<class Upstream>
+    static
+    void
+    send(Upstream& upstream, const std::error_code& ec) {
+        upstream.template send<typename protocol::error>(ec, ec.message());
+    }
+};
+
+template<class Event>
+struct offload_error<Event, mute_slot_tag> {
+    template<class Upstream>
+    static
+    void
+    send(Upstream& /* upstream */, const std::error_code& /* ec */) {
+        // Empty.
+    }
+};
+
+} // namespace aux
+
+template<
+    class Event,
+    class R = typename result_of<Event>::type
+>
+struct offload_slot:
+    public basic_slot<Event>
+{
+    typedef blocking_slot<Event, R> inner_type;
+
+    typedef typename inner_type::callable_type callable_type;
+    typedef typename inner_type::dispatch_type dispatch_type;
+    typedef typename inner_type::tuple_type    tuple_type;
+    typedef typename inner_type::upstream_type upstream_type;
+
+    static_assert(
+        !boost::mpl::contains<typename basic_slot<Event>::sequence_type, string_ref_t>::value,
+        "referenced arguments are only allowed in blocking slots"
+    );
+
+    offload_slot(callable_type callable, const std::shared_ptr<worker_pool_t>& pool_):
+        inner(std::make_shared<inner_type>(callable)),
+        pool(pool_)
+    { }
+
+    virtual
+    boost::optional<std::shared_ptr<const dispatch_type>>
+    operator()(tuple_type&& args, upstream_type&& upstream) {
+        const auto call = std::make_shared<call_t>(std::move(args), std::move(upstream));
+
+        const auto slot = inner;
+        const auto trace = trace_t::current();
+        const auto deadline = deadline_t::current();
+
+        const bool queued = pool->post([=] {
+            trace_t::restore_scope_t trace_scope(trace);
+            deadline_t::scope_t deadline_scope(deadline);
+
+            // NOTE: The invocation might have been waiting in the queue for longer than the client
+            // is willing to wait, then there's no point in running it at all.
+            if(deadline.expired()) {
+                return aux::offload_error<Event, R>::send(call->upstream, error::deadline_expired);
+            }
+
+            // NOTE: Blocking slots only let the errors of the mute callables through, and the errors
+            // of the upstream itself, e.g. if the client has disconnected in the meantime. There's
+            // no one to report them to.
+            (*slot)(std::move(call->args), std::move(call->upstream));
+        });
+
+        if(!queued) {
+            aux::offload_error<Event, R>::send(call->upstream, error::service_overloaded);
+        }
+
+        if(is_recursed<Event>::value) {
+            return boost::none;
+        } else {
+            return boost::make_optional<std::shared_ptr<const dispatch_type>>(nullptr);
+        }
+    }
+
+private:
+    struct call_t {
+        call_t(tuple_type&& args_, upstream_type&& upstream_):
+            args(std::move(args_)),
+            upstream(std::move(upstream_))
+        { }
+
+        tuple_type args;
+        upstream_type upstream;
+    };
+
+    const std::shared_ptr<inner_type> inner;
+    const std::shared_ptr<worker_pool_t> pool;
+};
+
+}} // namespace cocaine::io
+
+#endif
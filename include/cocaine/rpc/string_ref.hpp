@@ -0,0 +1,87 @@
+/*
+    Copyright (c) 2011-2015 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_IO_STRING_REF_HPP
+#define COCAINE_IO_STRING_REF_HPP
+
+#include <cstring>
+#include <string>
+
+namespace cocaine { namespace io {
+
+// Non-owning reference to a string argument, pointing directly into the session's read buffer. It
+// can be used in place of std::string in event argument lists to avoid copying large payloads out of
+// the incoming message. The referenced data is valid only until the slot invocation returns, so such
+// arguments are allowed for blocking slots only. Use str() to make a copy if it's needed later.
+
+struct string_ref_t {
+    string_ref_t():
+        blob(nullptr),
+        length(0)
+    { }
+
+    string_ref_t(const char* blob_, size_t length_):
+        blob(blob_),
+        length(length_)
+    { }
+
+    string_ref_t(const std::string& source):
+        blob(source.data()),
+        length(source.size())
+    { }
+
+    auto
+    data() const -> const char* {
+        return blob;
+    }
+
+    auto
+    size() const -> size_t {
+        return length;
+    }
+
+    bool
+    empty() const {
+        return length == 0;
+    }
+
+    auto
+    str() const -> std::string {
+        return std::string(blob, length);
+    }
+
+    bool
+    operator==(const string_ref_t& other) const {
+        return length == other.length && (length == 0 || std::memcmp(blob, other.blob, length) == 0);
+    }
+
+    bool
+    operator!=(const string_ref_t& other) const {
+        return !operator==(other);
+    }
+
+private:
+    const char* blob;
+    size_t length;
+};
+
+}} // namespace cocaine::io
+
+#endif
@@ -35,10 +35,12 @@ class basic_upstream_t {
 
 public:
     /* We only pass trace to client-side upstream, because we want to group all client-side sends under one trace_id */
-    basic_upstream_t(const std::shared_ptr<session_t>& session_, uint64_t channel_id_, boost::optional<trace_t> client_trace_):
+    basic_upstream_t(const std::shared_ptr<session_t>& session_, uint64_t channel_id_, boost::optional<trace_t> client_trace_,
+                     deadline_t deadline_ = deadline_t()):
         session(session_),
         channel_id(channel_id_),
-        client_trace(client_trace_)
+        client_trace(client_trace_),
+        deadline(deadline_)
     { }
 
     template<class Event, class... Args>
@@ -47,12 +49,16 @@ public:
 
     /* none_t if upstream belongs to server side */
     boost::optional<trace_t> client_trace;
+
+    /* Deadline forwarded to the forked channel, empty for the server side */
+    const deadline_t deadline;
 };
 
 template<class Event, class... Args>
 void
 basic_upstream_t::send(Args&&... args) {
     trace_t::restore_scope_t scope(client_trace);
+    deadline_t::scope_t deadline_scope(deadline);
     session->push(encoded<Event>(channel_id, std::forward<Args>(args)...));
 }
 
@@ -0,0 +1,80 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_IO_WORKER_POOL_HPP
+#define COCAINE_IO_WORKER_POOL_HPP
+
+#include "cocaine/common.hpp"
+
+#include <functional>
+#include <thread>
+
+namespace cocaine { namespace io {
+
+// Bounded pool of worker threads, which the offload slots run their callables on so that the engine
+// threads never block. Tasks over the queue limit are rejected rather than queued, so that a stalled
+// pool can't pile up unbounded amounts of work.
+
+class worker_pool_t {
+    COCAINE_DECLARE_NONCOPYABLE(worker_pool_t)
+
+public:
+    typedef std::function<void()> task_type;
+
+    struct stats_t {
+        // Number of tasks waiting in the queue and currently running.
+        size_t pending;
+        size_t active;
+
+        // Number of tasks completed and rejected so far.
+        uint64_t completed;
+        uint64_t rejected;
+    };
+
+    // At most limit tasks might be waiting in the queue at once. Threads are named after the pool.
+    worker_pool_t(const std::string& name, size_t threads, size_t limit);
+
+    // Waits for the pending tasks to complete.
+   ~worker_pool_t();
+
+    // Queues the task, unless the queue is full. Never blocks.
+    bool
+    post(task_type task);
+
+    auto
+    stats() const -> stats_t;
+
+private:
+    struct state_t;
+
+    static
+    void
+    run(const std::shared_ptr<state_t>& state, const std::string& name);
+
+    // NOTE: Shared with the worker threads, because the last reference to the pool might be dropped
+    // by some task, i.e. from one of the worker threads, which then can't be joined.
+    const std::shared_ptr<state_t> m_state;
+
+    std::vector<std::thread> m_threads;
+};
+
+}} // namespace cocaine::io
+
+#endif
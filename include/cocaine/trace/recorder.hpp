@@ -0,0 +1,117 @@
+/*
+    Copyright (c) 2011-2015 Anton Matveenko <antmat@yandex-team.ru>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_TRACE_RECORDER_HPP
+#define COCAINE_TRACE_RECORDER_HPP
+
+#include "cocaine/common.hpp"
+#include "cocaine/locked_ptr.hpp"
+
+#include "cocaine/trace/trace.hpp"
+
+#include <condition_variable>
+#include <thread>
+
+namespace cocaine {
+
+// Span recorder. Collects span annotations of the sampled traces into per-thread ring buffers, which
+// are periodically drained by a background thread and appended to a file as Zipkin JSON spans.
+
+class span_recorder_t {
+    COCAINE_DECLARE_NONCOPYABLE(span_recorder_t)
+
+    struct ring_t;
+
+public:
+    enum annotation_t: uint32_t {
+        client_send,
+        client_receive,
+        server_send,
+        server_receive
+    };
+
+    // Annotation value, as expected by Zipkin.
+    static
+    const char*
+    describe(annotation_t annotation);
+
+    struct event_t {
+        uint64_t trace_id;
+        uint64_t span_id;
+        uint64_t parent_id;
+
+        // Microseconds since the epoch.
+        uint64_t timestamp;
+
+        trace_t::name_t rpc_name;
+        trace_t::name_t endpoint;
+
+        annotation_t annotation;
+    };
+
+    span_recorder_t(context_t& context);
+   ~span_recorder_t();
+
+    bool
+    sampled(uint64_t trace_id) const {
+        return trace_id != trace_t::zero_value && trace_id <= m_threshold;
+    }
+
+    // Records an annotation for the specified trace, if it is sampled. Wait-free, annotations are
+    // dropped if the calling thread's buffer is full.
+    void
+    record(const trace_t& trace, trace_t::name_t endpoint, annotation_t annotation);
+
+private:
+    void
+    run();
+
+    void
+    flush();
+
+    ring_t&
+    ring();
+
+    const std::unique_ptr<logging::log_t> m_log;
+
+    // Unique recorder id, used to tell apart the per-thread buffers of different recorders.
+    const uint64_t m_id;
+
+    // Traces with ids not greater than the threshold are sampled.
+    const uint64_t m_threshold;
+
+    const std::string m_path;
+    const std::chrono::milliseconds m_interval;
+    const size_t m_capacity;
+
+    // Buffers of all the threads which have recorded anything. Buffers of exited threads are
+    // dropped once drained.
+    synchronized<std::vector<std::shared_ptr<ring_t>>> m_rings;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stopped;
+
+    std::thread m_thread;
+};
+
+} // namespace cocaine
+
+#endif
@@ -36,10 +36,16 @@ public:
     class restore_scope_t;
     class push_scope_t;
 
+    /**
+     * RPC names are interned into a process-wide name table, so that traces are trivially copyable
+     * and never allocate. Name 0 is the empty name.
+     */
+    typedef uint32_t name_t;
+
     struct state_t {
         uint64_t span_id;
         uint64_t parent_id;
-        std::string rpc_name;
+        name_t rpc_name;
     };
 
     static constexpr uint64_t zero_value = 0;
@@ -47,7 +53,13 @@ public:
     /**
      * Construct an empty trace.
      */
-    trace_t();
+    constexpr
+    trace_t():
+        trace_id(zero_value),
+        state{zero_value, zero_value, 0},
+        previous_state{zero_value, zero_value, 0},
+        is_pushed(false)
+    { }
 
     /**
      * Construct trace with specified tuple of ids and service and rpc name.
@@ -64,6 +76,21 @@ public:
     trace_t
     generate(const std::string& rpc_name);
 
+    /**
+     * Return the id of the specified name in the name table, adding it if necessary.
+     * Names are never removed from the table.
+     */
+    static
+    name_t
+    intern(const std::string& name);
+
+    /**
+     * Return the name with the specified id, or the empty name for unknown ids.
+     */
+    static
+    const std::string&
+    name(name_t id);
+
     /**
      * Return current trace.
      * Trace is usually set via scope guards and passed via callback wrapper in async callbacks.
@@ -81,6 +108,12 @@ public:
     uint64_t
     get_id() const;
 
+    const std::string&
+    get_rpc_name() const;
+
+    name_t
+    get_rpc_name_id() const;
+
     /**
      * Check if trace is empty (was not set via any of scope guards).
      */
@@ -112,7 +145,7 @@ public:
             {"trace_id", {to_hex_string(trace_id)}},
             {"span_id", {to_hex_string(state.span_id)}},
             {"parent_id", {to_hex_string(state.parent_id)}},
-            {"rpc_name", {state.rpc_name}}
+            {"rpc_name", {name(state.rpc_name)}}
         };
     }
 
@@ -123,7 +156,7 @@ public:
             {"trace_id", {trace_id}},
             {"span_id", {state.span_id}},
             {"parent_id", {state.parent_id}},
-            {"rpc_name", {state.rpc_name}}
+            {"rpc_name", {name(state.rpc_name)}}
         };
     }
 
@@ -148,7 +181,8 @@ private:
 
     uint64_t trace_id;
     state_t state;
-    boost::optional<state_t> previous_state;
+    state_t previous_state;
+    bool is_pushed;
 };
 
 class trace_t::restore_scope_t
@@ -0,0 +1,55 @@
+/*
+    Copyright (c) 2011-2015 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_STRING_REF_SERIALIZATION_TRAITS_HPP
+#define COCAINE_STRING_REF_SERIALIZATION_TRAITS_HPP
+
+#include "cocaine/traits.hpp"
+
+#include "cocaine/rpc/string_ref.hpp"
+
+namespace cocaine { namespace io {
+
+template<>
+struct type_traits<string_ref_t> {
+    template<class Stream>
+    static inline
+    void
+    pack(msgpack::packer<Stream>& target, const string_ref_t& source) {
+        target.pack_raw(source.size());
+        target.pack_raw_body(source.data(), source.size());
+    }
+
+    // NOTE: Unpacking doesn't copy anything, so the target references the memory owned by the source
+    // object's underlying buffer and is valid for as long as that buffer is.
+    static inline
+    void
+    unpack(const msgpack::object& source, string_ref_t& target) {
+        if(source.type != msgpack::type::RAW) {
+            throw msgpack::type_error();
+        }
+
+        target = string_ref_t(source.via.raw.ptr, source.via.raw.size);
+    }
+};
+
+}} // namespace cocaine::io
+
+#endif
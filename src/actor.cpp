@@ -25,6 +25,7 @@
 #include "cocaine/context.hpp"
 #include "cocaine/logging.hpp"
 
+#include "cocaine/detail/affinity.hpp"
 #include "cocaine/detail/chamber.hpp"
 #include "cocaine/detail/engine.hpp"
 
@@ -115,7 +116,8 @@ actor_t::actor_t(context_t& context, const std::shared_ptr<io_service>& asio,
     m_context(context),
     m_log(context.log("core/asio", {{"service", prototype->name()}})),
     m_asio(asio),
-    m_prototype(std::move(prototype))
+    m_prototype(std::move(prototype)),
+    m_reentrant(false)
 { }
 
 actor_t::actor_t(context_t& context, const std::shared_ptr<io_service>& asio,
@@ -123,7 +125,8 @@ actor_t::actor_t(context_t& context, const std::shared_ptr<io_service>& asio,
 :
     m_context(context),
     m_log(context.log("core/asio", {{"service", service->prototype().name()}})),
-    m_asio(asio)
+    m_asio(asio),
+    m_reentrant(service->reentrant())
 {
     const basic_dispatch_t* prototype = &service->prototype();
 
@@ -191,6 +194,39 @@ actor_t::prototype() const {
     return *m_prototype;
 }
 
+void
+actor_t::bind(std::unique_ptr<tcp::acceptor>& ptr, const tcp::endpoint& endpoint) {
+    // NOTE: In multi-acceptor mode, the service's own acceptor only reserves the endpoint and never
+    // listens, so that no connections are queued on it. Every engine listens on the endpoint on its
+    // own and serves the connections it accepts right away, without them being handed over from the
+    // service thread.
+    ptr = std::make_unique<tcp::acceptor>(*m_asio);
+
+    ptr->open(endpoint.protocol());
+    ptr->set_option(tcp::acceptor::reuse_address(true));
+#if defined(SO_REUSEPORT)
+    ptr->set_option(reuse_port(true));
+#endif
+    ptr->bind(endpoint);
+
+    // The port might have been chosen by the system.
+    const auto bound = ptr->local_endpoint();
+    const auto& engines = m_context.engines();
+
+    try {
+        for(auto it = engines.begin(); it != engines.end(); ++it) {
+            (*it)->listen(bound, m_prototype);
+        }
+    } catch(...) {
+        for(auto it = engines.begin(); it != engines.end(); ++it) {
+            (*it)->unlisten(m_prototype->name());
+        }
+
+        ptr = nullptr;
+        throw;
+    }
+}
+
 void
 actor_t::run() {
     m_acceptor.apply([this](std::unique_ptr<tcp::acceptor>& ptr) {
@@ -205,7 +241,11 @@ actor_t::run() {
         }
  
         try {
-            ptr = std::make_unique<tcp::acceptor>(*m_asio, endpoint);
+            if(m_context.config.network.reuseport) {
+                bind(ptr, endpoint);
+            } else {
+                ptr = std::make_unique<tcp::acceptor>(*m_asio, endpoint);
+            }
         } catch(const std::system_error& e) {
             COCAINE_LOG_ERROR(m_log, "unable to bind local endpoint %s for service: %s", endpoint, error::to_string(e));
             throw;
@@ -214,12 +254,38 @@ actor_t::run() {
         COCAINE_LOG_INFO(m_log, "exposing service on local endpoint %s", ptr->local_endpoint(ec));
     });
 
-    m_asio->post(std::bind(&accept_action_t::operator(),
-        std::make_shared<accept_action_t>(this)
-    ));
+    if(!m_context.config.network.reuseport) {
+        m_asio->post(std::bind(&accept_action_t::operator(),
+            std::make_shared<accept_action_t>(this)
+        ));
+    }
+
+    const auto& name = m_prototype->name();
+    const auto it = m_context.config.services.find(name);
+
+    size_t threads = 1;
+
+    if(it != m_context.config.services.end() && it->second.threads > 1) {
+        if(m_reentrant) {
+            threads = it->second.threads;
+        } else {
+            COCAINE_LOG_WARNING(m_log, "service is not reentrant, running it on a single thread");
+        }
+    }
 
-    // The post() above won't be executed until this thread is started.
-    m_chamber = std::make_unique<chamber_t>(m_prototype->name(), m_asio);
+    // The post() above won't be executed until these threads are started.
+    try {
+        while(m_chambers.size() != threads) {
+            m_chambers.emplace_back(std::make_unique<chamber_t>(name, m_asio,
+                m_context.affinity().service(name)));
+        }
+    } catch(...) {
+        // Otherwise the threads which have been started already would never stop.
+        m_asio->stop();
+        m_chambers.clear();
+        m_asio->reset();
+        throw;
+    }
 }
 
 void
@@ -229,7 +295,7 @@ actor_t::terminate() {
     m_asio->stop();
 
     // Does not block, unlike the one in execution_unit_t's destructors.
-    m_chamber = nullptr;
+    m_chambers.clear();
 
     m_acceptor.apply([this](std::unique_ptr<tcp::acceptor>& ptr) {
         std::error_code ec;
@@ -237,6 +303,14 @@ actor_t::terminate() {
 
         COCAINE_LOG_INFO(m_log, "removing service from local endpoint %s", endpoint);
 
+        if(m_context.config.network.reuseport) {
+            const auto& engines = m_context.engines();
+
+            for(auto it = engines.begin(); it != engines.end(); ++it) {
+                (*it)->unlisten(m_prototype->name());
+            }
+        }
+
         ptr = nullptr;
     });
 
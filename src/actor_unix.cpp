@@ -5,6 +5,7 @@
 #include "cocaine/context.hpp"
 #include "cocaine/logging.hpp"
 
+#include "cocaine/detail/affinity.hpp"
 #include "cocaine/detail/chamber.hpp"
 #include "cocaine/detail/engine.hpp"
 
@@ -117,7 +118,8 @@ unix_actor_t::run() {
     ));
 
     // The post() above won't be executed until this thread is started.
-    m_chamber = std::make_unique<io::chamber_t>(m_prototype->name(), m_asio);
+    m_chamber = std::make_unique<io::chamber_t>(m_prototype->name(), m_asio,
+        m_context.affinity().service(m_prototype->name()));
 }
 
 void
@@ -0,0 +1,68 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/detail/admission.hpp"
+
+#include <algorithm>
+
+using namespace cocaine::io;
+
+admission_t::admission_t(clock_type::duration target, clock_type::duration interval):
+    m_target(target),
+    m_interval(interval),
+    m_delay(clock_type::duration::zero()),
+    m_minimum(clock_type::duration::max()),
+    m_interval_end(clock_type::now() + interval),
+    m_overloaded(false),
+    m_admitted(0),
+    m_shed(0),
+    m_shed_interval(0)
+{ }
+
+void
+admission_t::sample(clock_type::duration delay, clock_type::time_point now) {
+    m_delay   = delay;
+    m_minimum = std::min(m_minimum, delay);
+
+    if(now < m_interval_end) {
+        return;
+    }
+
+    // NOTE: If even the best delay over the whole interval was above the target, then there's a
+    // standing queue, not a burst. Once overloaded, the delay is kept around the target by shedding,
+    // so the engine is only considered recovered after a whole interval without shedding.
+    m_overloaded.store(m_minimum > m_target || (overloaded() && m_shed_interval != shed()),
+        std::memory_order_relaxed);
+
+    m_minimum = clock_type::duration::max();
+    m_shed_interval = shed();
+    m_interval_end = now + m_interval;
+}
+
+bool
+admission_t::admit() {
+    if(m_delay > (overloaded() ? m_target : m_interval)) {
+        m_shed.store(shed() + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    m_admitted.store(admitted() + 1, std::memory_order_relaxed);
+    return true;
+}
@@ -0,0 +1,205 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/detail/affinity.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/thread/thread.hpp>
+
+#if defined(__linux__)
+    #include <sched.h>
+#endif
+
+using namespace cocaine;
+using namespace cocaine::io;
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+// Parses the kernel CPU list format, e.g. "0-3,8-11".
+affinity_t::cores_type
+parse(const std::string& list) {
+    affinity_t::cores_type result;
+
+    std::istringstream stream(list);
+    std::string range;
+
+    while(std::getline(stream, range, ',')) {
+        unsigned int first = 0, last = 0;
+        char dash = 0;
+
+        std::istringstream parser(range);
+
+        if(!(parser >> first)) {
+            continue;
+        }
+
+        if(!(parser >> dash >> last) || dash != '-') {
+            last = first;
+        }
+
+        for(unsigned int core = first; core <= last; ++core) {
+            result.push_back(core);
+        }
+    }
+
+    return result;
+}
+
+affinity_t::cores_type
+allowed() {
+    affinity_t::cores_type result;
+
+#if defined(__linux__)
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+
+    if(::sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for(unsigned int core = 0; core < CPU_SETSIZE; ++core) {
+            if(CPU_ISSET(core, &set)) {
+                result.push_back(core);
+            }
+        }
+
+        return result;
+    }
+#endif
+
+    for(unsigned int core = 0; core < boost::thread::hardware_concurrency(); ++core) {
+        result.push_back(core);
+    }
+
+    return result;
+}
+
+std::vector<affinity_t::cores_type>
+topology(const affinity_t::cores_type& cores) {
+    std::vector<affinity_t::cores_type> nodes;
+
+    const fs::path root("/sys/devices/system/node");
+
+    for(unsigned int node = 0; ; ++node) {
+        std::ifstream stream((root / ("node" + std::to_string(node)) / "cpulist").string());
+        std::string list;
+
+        if(!stream || !std::getline(stream, list)) {
+            break;
+        }
+
+        const auto present = parse(list);
+
+        affinity_t::cores_type local;
+
+        // NOTE: Nodes without any allowed cores are still kept, so that the node numbers match.
+        std::set_intersection(present.begin(), present.end(), cores.begin(), cores.end(),
+            std::back_inserter(local));
+
+        nodes.push_back(local);
+    }
+
+    if(nodes.empty()) {
+        nodes.push_back(cores);
+    }
+
+    return nodes;
+}
+
+} // namespace
+
+affinity_t::affinity_t(const config_t& config):
+    m_engines(config.affinity.engines),
+    m_services(config.affinity.services),
+    m_engine(0),
+    m_next(0)
+{
+    if(m_engines.empty() && m_services.empty()) {
+        return;
+    }
+
+    m_nodes = topology(allowed());
+
+    size_t widest = 0;
+
+    for(auto it = m_nodes.begin(); it != m_nodes.end(); ++it) {
+        widest = std::max(widest, it->size());
+    }
+
+    // Interleave the nodes, so that the automatically placed threads are spread over all of them.
+    for(size_t i = 0; i < widest; ++i) {
+        for(auto it = m_nodes.begin(); it != m_nodes.end(); ++it) {
+            if(i < it->size()) {
+                m_order.push_back((*it)[i]);
+            }
+        }
+    }
+
+    if(m_order.empty()) {
+        throw cocaine::error_t("no cores are available for the thread placement");
+    }
+}
+
+auto
+affinity_t::engine() -> cores_type {
+    if(m_engines.empty()) {
+        return cores_type();
+    }
+
+    return resolve(m_engines[m_engine++ % m_engines.size()]);
+}
+
+auto
+affinity_t::service(const std::string& name) -> cores_type {
+    const auto it = m_services.find(name);
+
+    if(it == m_services.end()) {
+        return cores_type();
+    }
+
+    return resolve(it->second);
+}
+
+auto
+affinity_t::resolve(const config_t::placement_t& placement) -> cores_type {
+    if(placement.automatic) {
+        return cores_type({m_order[m_next++ % m_order.size()]});
+    }
+
+    cores_type result(placement.cores);
+
+    for(auto it = placement.nodes.begin(); it != placement.nodes.end(); ++it) {
+        if(*it >= m_nodes.size()) {
+            throw cocaine::error_t("NUMA node %d does not exist", *it);
+        }
+
+        result.insert(result.end(), m_nodes[*it].begin(), m_nodes[*it].end());
+    }
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+
+    return result;
+}
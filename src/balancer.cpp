@@ -0,0 +1,112 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/detail/balancer.hpp"
+
+#include "cocaine/detail/engine.hpp"
+
+#include <algorithm>
+#include <random>
+
+using namespace cocaine;
+
+namespace {
+
+typedef balancer_t::pool_type::value_type engine_ptr;
+
+struct utilization_t {
+    bool
+    operator()(const engine_ptr& lhs, const engine_ptr& rhs) const {
+        return lhs->utilization() < rhs->utilization();
+    }
+};
+
+struct sessions_t {
+    bool
+    operator()(const engine_ptr& lhs, const engine_ptr& rhs) const {
+        return lhs->load().sessions.load(std::memory_order_relaxed) <
+               rhs->load().sessions.load(std::memory_order_relaxed);
+    }
+};
+
+// Channels are the invocations in progress, so they are the closest thing to the engine's pending
+// work. Sessions break the ties, which is what matters during connection storms.
+struct channels_t {
+    bool
+    operator()(const engine_ptr& lhs, const engine_ptr& rhs) const {
+        const size_t lhs_channels = lhs->load().channels.load(std::memory_order_relaxed);
+        const size_t rhs_channels = rhs->load().channels.load(std::memory_order_relaxed);
+
+        if(lhs_channels != rhs_channels) {
+            return lhs_channels < rhs_channels;
+        }
+
+        return sessions_t()(lhs, rhs);
+    }
+};
+
+template<class Compare>
+struct scanning_balancer_t:
+    public balancer_t
+{
+    virtual
+    execution_unit_t&
+    select(const pool_type& pool) {
+        return **std::min_element(pool.begin(), pool.end(), Compare());
+    }
+};
+
+struct two_choices_balancer_t:
+    public balancer_t
+{
+    virtual
+    execution_unit_t&
+    select(const pool_type& pool) {
+        static thread_local std::minstd_rand generator(std::random_device{}());
+
+        if(pool.size() < 2) {
+            return *pool.front();
+        }
+
+        const size_t first = generator() % pool.size();
+
+        // NOTE: The second choice is always a different engine.
+        const size_t second = (first + 1 + generator() % (pool.size() - 1)) % pool.size();
+
+        return channels_t()(pool[second], pool[first]) ? *pool[second] : *pool[first];
+    }
+};
+
+} // namespace
+
+auto
+cocaine::make_balancer(const std::string& strategy) -> std::unique_ptr<balancer_t> {
+    if(strategy == "load") {
+        return std::make_unique<scanning_balancer_t<utilization_t>>();
+    } else if(strategy == "sessions") {
+        return std::make_unique<scanning_balancer_t<sessions_t>>();
+    } else if(strategy == "channels") {
+        return std::make_unique<scanning_balancer_t<channels_t>>();
+    } else if(strategy == "two-choices") {
+        return std::make_unique<two_choices_balancer_t>();
+    }
+
+    throw cocaine::error_t("unknown engine balancing strategy '%s'", strategy);
+}
@@ -24,15 +24,54 @@
 #include <sstream>
 
 #if defined(__linux__)
+    #include <pthread.h>
+    #include <sched.h>
     #include <sys/prctl.h>
 #elif defined(__APPLE__)
     #include <pthread.h>
 #endif
 
 #include <sys/resource.h>
+#include <time.h>
 
 using namespace cocaine::io;
 
+namespace {
+
+// CPU time consumed by the specified thread, in microseconds. Handlers of the reactors shared by the
+// chambers of a multi-threaded service run on any of their threads, so the calling thread is not the
+// one to measure.
+bool
+cpu_time(boost::thread& thread, int64_t& result) {
+#if defined(__linux__)
+    clockid_t clock;
+    struct timespec value;
+
+    if(::pthread_getcpuclockid(thread.native_handle(), &clock) != 0 ||
+       ::clock_gettime(clock, &value) != 0)
+    {
+        return false;
+    }
+
+    result = value.tv_sec * 1000000ll + value.tv_nsec / 1000;
+#else
+    (void)thread;
+
+    struct rusage usage;
+
+    if(getrusage(RUSAGE_SELF, &usage) != 0) {
+        return false;
+    }
+
+    result = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ll +
+        usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+#endif
+
+    return true;
+}
+
+} // namespace
+
 // Chamber internals
 
 class chamber_t::named_runnable_t {
@@ -70,17 +109,16 @@ class chamber_t::stats_periodic_action_t:
     chamber_t *const parent;
     const boost::posix_time::seconds interval;
 
-    // Snapshot of the last getrusage(2) report to be able to calculate the difference.
-    struct rusage last_tick;
+    // CPU time of the chamber thread at the last collection to be able to calculate the difference.
+    int64_t last_tick;
 
 public:
     template<class Interval>
     stats_periodic_action_t(chamber_t *const parent_, Interval interval_):
         parent(parent_),
-        interval(interval_)
-    {
-        std::memset(&last_tick, 0, sizeof(last_tick));
-    }
+        interval(interval_),
+        last_tick(0)
+    { }
 
     void
     operator()();
@@ -106,44 +144,102 @@ chamber_t::stats_periodic_action_t::finalize(const std::error_code& ec) {
         return;
     }
 
-    struct rusage  this_tick, tick_diff;
-    struct timeval real_time = { 0, 0 };
+    int64_t this_tick;
+
+    if(cpu_time(*parent->thread, this_tick)) {
+        (*parent->load_acc1.synchronize())(
+            static_cast<double>(this_tick - last_tick) / interval.total_microseconds()
+        );
 
-    std::memset(&tick_diff, 0, sizeof(tick_diff));
+        // Store the snapshot for the next iteration.
+        last_tick = this_tick;
+    }
+
+    operator()();
+}
+
+// Chamber
+
+namespace bpt = boost::posix_time;
 
 #if defined(__linux__)
-    getrusage(RUSAGE_THREAD, &this_tick);
-#else
-    getrusage(RUSAGE_SELF, &this_tick);
-#endif
 
-    // Calculate the difference.
-    timersub(&this_tick.ru_utime, &last_tick.ru_utime, &tick_diff.ru_utime);
-    timersub(&this_tick.ru_stime, &last_tick.ru_stime, &tick_diff.ru_stime);
+namespace {
 
-    // Store the snapshot for the next iteration.
-    last_tick = this_tick;
+// Pins the calling thread to the specified cores for the lifetime of the object, unless there are
+// none, then restores its original affinity.
+class scoped_affinity_t {
+    cpu_set_t saved;
+    bool active;
 
-    // Sum up the user and system running time.
-    timeradd(&tick_diff.ru_utime, &tick_diff.ru_stime, &real_time);
+public:
+    explicit
+    scoped_affinity_t(const std::vector<unsigned int>& cores):
+        active(false)
+    {
+        if(cores.empty()) {
+            return;
+        }
 
-    (*parent->load_acc1.synchronize())(
-        (real_time.tv_sec * 1e+6 + real_time.tv_usec) / interval.total_microseconds()
-    );
+        cpu_set_t set;
 
-    operator()();
-}
+        CPU_ZERO(&set);
 
-// Chamber
+        for(auto it = cores.begin(); it != cores.end(); ++it) {
+            if(*it >= CPU_SETSIZE) {
+                throw std::system_error(std::make_error_code(std::errc::invalid_argument),
+                    "unable to pin thread to core " + std::to_string(*it));
+            }
 
-namespace bpt = boost::posix_time;
+            CPU_SET(*it, &set);
+        }
+
+        if(const int rv = ::pthread_getaffinity_np(::pthread_self(), sizeof(saved), &saved)) {
+            throw std::system_error(rv, std::system_category(), "unable to pin thread");
+        }
+
+        if(const int rv = ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set)) {
+            throw std::system_error(rv, std::system_category(), "unable to pin thread");
+        }
+
+        active = true;
+    }
+
+   ~scoped_affinity_t() {
+        if(active) {
+            ::pthread_setaffinity_np(::pthread_self(), sizeof(saved), &saved);
+        }
+    }
+};
+
+} // namespace
+
+#endif
 
 chamber_t::chamber_t(const std::string& name_, const std::shared_ptr<asio::io_service>& asio_):
+    chamber_t(name_, asio_, std::vector<unsigned int>())
+{ }
+
+chamber_t::chamber_t(const std::string& name_, const std::shared_ptr<asio::io_service>& asio_,
+                     const std::vector<unsigned int>& cores)
+:
     name(name_),
     asio(asio_),
     cron(*asio_),
     load_acc1(boost::accumulators::rolling_window_size = 60 / kCollectionInterval)
 {
+#if defined(__linux__)
+    // NOTE: New threads inherit the affinity of the creating thread, so the calling thread is pinned
+    // until the chamber thread is started. This way the chamber thread never runs anywhere else, and
+    // everything it ever allocates ends up on the local NUMA node.
+    const scoped_affinity_t affinity(cores);
+#else
+    if(!cores.empty()) {
+        throw std::system_error(std::make_error_code(std::errc::operation_not_supported),
+            "unable to pin thread");
+    }
+#endif
+
     asio->post(std::bind(&stats_periodic_action_t::operator(),
         std::make_shared<stats_periodic_action_t>(this, bpt::seconds(kCollectionInterval))
     ));
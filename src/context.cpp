@@ -22,13 +22,18 @@
 
 #include "cocaine/api/service.hpp"
 
+#include "cocaine/detail/affinity.hpp"
+#include "cocaine/detail/balancer.hpp"
 #include "cocaine/detail/engine.hpp"
 #include "cocaine/detail/essentials.hpp"
+#include "cocaine/detail/quota.hpp"
 
 #include "cocaine/logging.hpp"
 
 #include "cocaine/rpc/actor.hpp"
 
+#include "cocaine/trace/recorder.hpp"
+
 #include <blackhole/scoped_attributes.hpp>
 
 #include <boost/spirit/include/karma_char.hpp>
@@ -59,6 +64,24 @@ context_t::context_t(config_t config_, std::unique_ptr<logging::log_t> log_):
     // Load the rest of plugins.
     m_repository->load(config.path.plugins);
 
+    if(config.tracing.sample > 0) {
+        m_recorder = std::make_unique<span_recorder_t>(*this);
+    }
+
+    if(config.network.quotas.address.channels || config.network.quotas.address.rate) {
+        m_quotas = std::make_unique<io::quota_table_t>(
+            config.network.quotas.address.channels,
+            config.network.quotas.address.rate,
+            config.network.quotas.address.burst
+        );
+    }
+
+    m_affinity = std::make_unique<io::affinity_t>(config);
+
+    if(!config.affinity.engines.empty() || !config.affinity.services.empty()) {
+        COCAINE_LOG_INFO(m_log, "pinning threads, %d NUMA node(s) available", m_affinity->nodes());
+    }
+
     // Spin up all the configured services, launch execution units.
     bootstrap();
 }
@@ -167,27 +190,37 @@ context_t::locate(const std::string& name) const {
     return boost::optional<const actor_t&>(it->second->is_active(), *it->second);
 }
 
-namespace {
+execution_unit_t&
+context_t::engine() {
+    return m_balancer->select(m_pool);
+}
 
-struct utilization_t {
-    typedef std::unique_ptr<execution_unit_t> value_type;
+auto
+context_t::engines() const -> const std::vector<std::unique_ptr<execution_unit_t>>& {
+    return m_pool;
+}
 
-    bool
-    operator()(const value_type& lhs, const value_type& rhs) const {
-        return lhs->utilization() < rhs->utilization();
-    }
-};
+auto
+context_t::quotas() -> io::quota_table_t* {
+    return m_quotas.get();
+}
 
-} // namespace
+auto
+context_t::affinity() -> io::affinity_t& {
+    return *m_affinity;
+}
 
-execution_unit_t&
-context_t::engine() {
-    return **std::min_element(m_pool.begin(), m_pool.end(), utilization_t());
+auto
+context_t::recorder() -> span_recorder_t* {
+    return m_recorder.get();
 }
 
 void
 context_t::bootstrap() {
-    COCAINE_LOG_INFO(m_log, "starting %d execution unit(s)", config.network.pool);
+    COCAINE_LOG_INFO(m_log, "starting %d execution unit(s), balancing strategy: '%s'",
+        config.network.pool, config.network.balancer);
+
+    m_balancer = make_balancer(config.network.balancer);
 
     while(m_pool.size() != config.network.pool) {
         m_pool.emplace_back(std::make_unique<execution_unit_t>(*this));
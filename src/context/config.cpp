@@ -249,6 +249,89 @@ struct dynamic_converter<config_t::component_t> {
     }
 };
 
+template<>
+struct dynamic_converter<config_t::service_t> {
+    typedef config_t::service_t result_type;
+
+    static
+    result_type
+    convert(const dynamic_t& from) {
+        return config_t::service_t {
+            from.as_object().at("type", "unspecified").as_string(),
+            from.as_object().at("args", dynamic_t::object_t()),
+            from.as_object().at("threads", 1).to<unsigned int>()
+        };
+    }
+};
+
+template<>
+struct dynamic_converter<config_t::corking_t> {
+    typedef config_t::corking_t result_type;
+
+    static
+    result_type
+    convert(const dynamic_t& from) {
+        return config_t::corking_t {
+            from.as_object().at("bytes", 65536).to<size_t>(),
+            from.as_object().at("latency", 0).to<unsigned int>()
+        };
+    }
+};
+
+template<>
+struct dynamic_converter<config_t::admission_t> {
+    typedef config_t::admission_t result_type;
+
+    static
+    result_type
+    convert(const dynamic_t& from) {
+        return config_t::admission_t {
+            from.as_object().at("target", 5).to<unsigned int>(),
+            from.as_object().at("interval", 100).to<unsigned int>()
+        };
+    }
+};
+
+template<>
+struct dynamic_converter<config_t::quota_t> {
+    typedef config_t::quota_t result_type;
+
+    static
+    result_type
+    convert(const dynamic_t& from) {
+        const auto rate = from.as_object().at("rate", 0).to<unsigned int>();
+
+        return config_t::quota_t {
+            from.as_object().at("channels", 0).to<size_t>(),
+            rate,
+            from.as_object().at("burst", rate).to<unsigned int>()
+        };
+    }
+};
+
+template<>
+struct dynamic_converter<config_t::placement_t> {
+    typedef config_t::placement_t result_type;
+
+    static
+    result_type
+    convert(const dynamic_t& from) {
+        if(from.is_string()) {
+            if(from.as_string() != "auto") {
+                throw cocaine::error_t("unknown thread placement '%s'", from.as_string());
+            }
+
+            return config_t::placement_t{true, {}, {}};
+        }
+
+        return config_t::placement_t {
+            false,
+            from.as_object().at("cores", dynamic_t::empty_array).to<std::vector<unsigned int>>(),
+            from.as_object().at("nodes", dynamic_t::empty_array).to<std::vector<unsigned int>>()
+        };
+    }
+};
+
 template<>
 struct dynamic_converter<config_t::logging_t> {
     typedef config_t::logging_t result_type;
@@ -389,6 +472,15 @@ config_t::config_t(const std::string& source) {
         throw cocaine::error_t("network I/O pool size must be positive");
     }
 
+    network.balancer  = network_config.at("balancer", "load").as_string();
+    network.reuseport = network_config.at("reuseport", false).to<bool>();
+
+#if !defined(SO_REUSEPORT)
+    if(network.reuseport) {
+        throw cocaine::error_t("network multi-acceptor mode is not supported on this platform");
+    }
+#endif
+
     if(network_config.count("pinned")) {
         network.ports.pinned = network_config.at("pinned").to<decltype(network.ports.pinned)>();
     }
@@ -397,13 +489,91 @@ config_t::config_t(const std::string& source) {
         network.ports.shared = network_config.at("shared").to<decltype(network.ports.shared)>();
     }
 
+    const auto buffers_config = network_config.at("buffers", dynamic_t::empty_object).as_object();
+
+    network.buffers.pooled   = buffers_config.at("pooled", false).to<bool>();
+    network.buffers.capacity = buffers_config.at("capacity", 1024).to<size_t>();
+
+    const auto watermarks_config = network_config.at("watermarks", dynamic_t::empty_object).as_object();
+
+    network.watermarks.high = watermarks_config.at("high", 0).to<size_t>();
+    network.watermarks.low  = watermarks_config.at("low", network.watermarks.high / 2).to<size_t>();
+
+    if(network.watermarks.low > network.watermarks.high) {
+        throw cocaine::error_t("network low watermark must not exceed the high watermark");
+    }
+
+    if(network_config.count("corking")) {
+        network.corking = network_config.at("corking").to<decltype(network.corking)>();
+    }
+
+    network.huffman = network_config.at("huffman", false).to<bool>();
+
+    if(network_config.count("admission")) {
+        network.admission = network_config.at("admission").to<decltype(network.admission)>();
+    }
+
+    for(auto it = network.admission.begin(); it != network.admission.end(); ++it) {
+        if(!it->second.target || it->second.interval < it->second.target) {
+            throw cocaine::error_t("admission target for service '%s' must be positive and must not "
+                "exceed the interval", it->first);
+        }
+    }
+
+    const auto quotas_config = network_config.at("quotas", dynamic_t::empty_object).as_object();
+
+    network.quotas.session = quotas_config.at("session", dynamic_t::empty_object)
+        .to<config_t::quota_t>();
+    network.quotas.address = quotas_config.at("address", dynamic_t::empty_object)
+        .to<config_t::quota_t>();
+
+    // Span recording configuration
+    const auto tracing_config = root.as_object().at("tracing", dynamic_t::empty_object).as_object();
+
+    tracing.sample   = tracing_config.at("sample", 0).to<double>();
+    tracing.path     = tracing_config.at("path", defaults::spans_path).as_string();
+    tracing.interval = tracing_config.at("interval", 1000).to<unsigned int>();
+    tracing.buffer   = tracing_config.at("buffer", 4096).to<size_t>();
+
+    if(tracing.sample < 0 || tracing.sample > 1) {
+        throw cocaine::error_t("tracing sample rate must be within [0, 1]");
+    }
+
+    if(tracing.sample > 0 && (!tracing.interval || !tracing.buffer)) {
+        throw cocaine::error_t("tracing interval and buffer size must be positive");
+    }
+
+    // Thread placement configuration
+    const auto affinity_config = root.as_object().at("affinity", dynamic_t::empty_object).as_object();
+
+    if(affinity_config.count("engines")) {
+        const auto& engines = affinity_config.at("engines");
+
+        // A single placement applies to all the I/O threads.
+        if(engines.is_array()) {
+            affinity.engines = engines.to<decltype(affinity.engines)>();
+        } else {
+            affinity.engines.push_back(engines.to<config_t::placement_t>());
+        }
+    }
+
+    if(affinity_config.count("services")) {
+        affinity.services = affinity_config.at("services").to<decltype(affinity.services)>();
+    }
+
     // Blackhole logging configuration
     logging = root.as_object().at("logging",  dynamic_t::empty_object).to<config_t::logging_t>();
 
     // Component configuration
-    services = root.as_object().at("services", dynamic_t::empty_object).to<config_t::component_map_t>();
+    services = root.as_object().at("services", dynamic_t::empty_object).to<config_t::service_map_t>();
     storages = root.as_object().at("storages", dynamic_t::empty_object).to<config_t::component_map_t>();
 
+    for(auto it = services.begin(); it != services.end(); ++it) {
+        if(!it->second.threads) {
+            throw cocaine::error_t("number of threads for service '%s' must be positive", it->first);
+        }
+    }
+
 #ifdef COCAINE_ALLOW_RAFT
     create_raft_cluster = false;
 #endif
@@ -0,0 +1,71 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "cocaine/rpc/deadline.hpp"
+
+#include <algorithm>
+#include <limits>
+
+using namespace cocaine::io;
+
+namespace {
+
+thread_local deadline_t current_deadline;
+
+// Budgets are capped, so that the expiry never overflows. No one waits for a reply that long anyway.
+const int64_t kMaximumBudget = 86400ll * 1000000;
+
+int64_t
+now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        deadline_t::clock_type::now().time_since_epoch()
+    ).count();
+}
+
+} // namespace
+
+deadline_t
+deadline_t::after(std::chrono::microseconds budget) {
+    deadline_t deadline;
+
+    deadline.expiry = now() + std::min<int64_t>(std::max<int64_t>(budget.count(), 0), kMaximumBudget);
+
+    return deadline;
+}
+
+deadline_t&
+deadline_t::current() {
+    return current_deadline;
+}
+
+bool
+deadline_t::expired() const {
+    return !empty() && expiry <= now();
+}
+
+std::chrono::microseconds
+deadline_t::remaining() const {
+    if(empty()) {
+        return std::chrono::microseconds::max();
+    }
+
+    return std::chrono::microseconds(std::max<int64_t>(expiry - now(), 0));
+}
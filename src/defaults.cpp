@@ -28,4 +28,6 @@ const std::string defaults::runtime_path  = "/var/run/cocaine";
 const std::string defaults::endpoint      = "::";
 
 const std::string defaults::log_verbosity = "info";
-const std::string defaults::log_timestamp = "%Y-%m-%d %H:%M:%S.%f";
\ No newline at end of file
+const std::string defaults::log_timestamp = "%Y-%m-%d %H:%M:%S.%f";
+
+const std::string defaults::spans_path    = "/var/log/cocaine/spans.json";
\ No newline at end of file
@@ -23,8 +23,13 @@
 #include "cocaine/context.hpp"
 #include "cocaine/logging.hpp"
 
+#include "cocaine/detail/admission.hpp"
+#include "cocaine/detail/affinity.hpp"
+#include "cocaine/detail/balancer.hpp"
 #include "cocaine/detail/chamber.hpp"
+#include "cocaine/detail/quota.hpp"
 
+#include "cocaine/rpc/asio/buffer_pool.hpp"
 #include "cocaine/rpc/asio/transport.hpp"
 #include "cocaine/rpc/session.hpp"
 
@@ -41,12 +46,33 @@ using namespace asio;
 
 using namespace blackhole;
 
+namespace {
+
+// Remote address of the client, which the address quotas are tracked by.
+
+std::string
+address_of(const ip::tcp::endpoint& endpoint) {
+    return endpoint.address().to_string();
+}
+
+template<class Endpoint>
+std::string
+address_of(const Endpoint&) {
+    return std::string();
+}
+
+} // namespace
+
 class execution_unit_t::gc_action_t:
     public std::enable_shared_from_this<gc_action_t>
 {
     execution_unit_t *const parent;
     const boost::posix_time::seconds repeat;
 
+    // Invocations shed so far per service at the last collection, so that only the new ones are
+    // reported.
+    std::map<std::string, uint64_t> shed;
+
 public:
     template<class Interval>
     gc_action_t(execution_unit_t *const parent_, Interval repeat_):
@@ -85,7 +111,7 @@ execution_unit_t::gc_action_t::finalize(const std::error_code& ec) {
     size_t recycled = 0;
 
     for(auto it = parent->m_sessions.begin(); it != parent->m_sessions.end();) {
-        if(!it->second->memory_pressure()) {
+        if(it->second->is_detached()) {
             recycled++;
             it = parent->m_sessions.erase(it);
             continue;
@@ -98,19 +124,213 @@ execution_unit_t::gc_action_t::finalize(const std::error_code& ec) {
         COCAINE_LOG_DEBUG(parent->m_log, "recycled %d session(s)", recycled);
     }
 
+    if(parent->m_buffers) {
+        const auto stats = parent->m_buffers->stats();
+
+        COCAINE_LOG_DEBUG(parent->m_log, "read buffer pool: %d idle, %d borrowed buffer(s)",
+            stats.idle, stats.borrowed);
+    }
+
+    const auto current = parent->shed();
+
+    for(auto it = current.begin(); it != current.end(); ++it) {
+        const uint64_t last = shed[it->first];
+
+        if(it->second != last) {
+            COCAINE_LOG_INFO(parent->m_log, "service '%s' has shed %d invocation(s) in the last %d "
+                "seconds, %d so far", it->first, it->second - last, repeat.total_seconds(),
+                it->second);
+        }
+    }
+
+    shed = current;
+
+    operator()();
+}
+
+class execution_unit_t::probe_action_t:
+    public std::enable_shared_from_this<probe_action_t>
+{
+    typedef admission_t::clock_type clock_type;
+
+    execution_unit_t *const parent;
+    const clock_type::duration repeat;
+
+    // Time the probe is due to fire at.
+    clock_type::time_point expected;
+
+public:
+    template<class Interval>
+    probe_action_t(execution_unit_t *const parent_, Interval repeat_):
+        parent(parent_),
+        repeat(repeat_)
+    { }
+
+    void
+    operator()();
+
+private:
+    void
+    finalize(const std::error_code& ec);
+};
+
+void
+execution_unit_t::probe_action_t::operator()() {
+    if(!parent->m_probe) {
+        return;
+    }
+
+    expected = clock_type::now() + repeat;
+
+    parent->m_probe->expires_from_now(boost::posix_time::microseconds(
+        std::chrono::duration_cast<std::chrono::microseconds>(repeat).count()
+    ));
+
+    parent->m_probe->async_wait(std::bind(&probe_action_t::finalize,
+        shared_from_this(),
+        std::placeholders::_1
+    ));
+}
+
+void
+execution_unit_t::probe_action_t::finalize(const std::error_code& ec) {
+    if(ec == asio::error::operation_aborted) {
+        return;
+    }
+
+    const auto now = clock_type::now();
+
+    // NOTE: The probe is late by as much as the handlers queued ahead of it took to run, which is
+    // the time the new invocations have to wait too.
+    const auto delay = std::max(now - expected, clock_type::duration::zero());
+
+    for(auto it = parent->m_admission.begin(); it != parent->m_admission.end(); ++it) {
+        const bool overloaded = it->second->overloaded();
+
+        it->second->sample(delay, now);
+
+        if(it->second->overloaded() == overloaded) {
+            continue;
+        }
+
+        if(!overloaded) {
+            COCAINE_LOG_WARNING(parent->m_log, "service '%s' is overloaded, shedding new invocations, "
+                "queueing delay: %d ms", it->first,
+                std::chrono::duration_cast<std::chrono::milliseconds>(delay).count());
+        } else {
+            COCAINE_LOG_INFO(parent->m_log, "service '%s' is no longer overloaded, %d invocation(s) "
+                "shed so far", it->first, it->second->shed());
+        }
+    }
+
+    operator()();
+}
+
+class execution_unit_t::accept_action_t:
+    public std::enable_shared_from_this<accept_action_t>
+{
+    execution_unit_t *const parent;
+
+    const std::shared_ptr<ip::tcp::acceptor> acceptor;
+    const dispatch_ptr_t dispatch;
+
+    ip::tcp::socket socket;
+
+public:
+    accept_action_t(execution_unit_t *const parent_, const std::shared_ptr<ip::tcp::acceptor>& acceptor_,
+                    const dispatch_ptr_t& dispatch_)
+    :
+        parent(parent_),
+        acceptor(acceptor_),
+        dispatch(dispatch_),
+        socket(*parent->m_asio)
+    { }
+
+    void
+    operator()();
+
+private:
+    void
+    finalize(const std::error_code& ec);
+};
+
+void
+execution_unit_t::accept_action_t::operator()() {
+    if(!acceptor->is_open()) {
+        return;
+    }
+
+    acceptor->async_accept(socket, std::bind(&accept_action_t::finalize,
+        shared_from_this(),
+        std::placeholders::_1
+    ));
+}
+
+void
+execution_unit_t::accept_action_t::finalize(const std::error_code& ec) {
+    // NOTE: The socket already belongs to this engine's reactor, so unlike the connections accepted
+    // by the services, it's attached as is.
+    auto ptr = std::make_unique<ip::tcp::socket>(std::move(socket));
+
+    switch(ec.value()) {
+    case 0:
+        COCAINE_LOG_DEBUG(parent->m_log, "accepted connection on fd %d", ptr->native_handle());
+
+        try {
+            parent->adopt(std::move(ptr), dispatch);
+        } catch(const std::system_error& e) {
+            COCAINE_LOG_ERROR(parent->m_log, "unable to attach connection to engine: %s",
+                error::to_string(e));
+        }
+
+        break;
+
+    case asio::error::operation_aborted:
+        return;
+
+    default:
+        COCAINE_LOG_ERROR(parent->m_log, "unable to accept connection: [%d] %s", ec.value(),
+            ec.message());
+        break;
+    }
+
     operator()();
 }
 
 execution_unit_t::execution_unit_t(context_t& context):
+    m_context(context),
+    m_load(std::make_shared<load_t>()),
     m_asio(new io_service()),
-    m_chamber(new chamber_t("core/asio", m_asio)),
+    m_chamber(new chamber_t("core/asio", m_asio, context.affinity().engine())),
     m_log(context.log("core/asio", {{"engine", m_chamber->thread_id()}})),
     m_cron(new asio::deadline_timer(*m_asio))
 {
+    if(context.config.network.buffers.pooled) {
+        m_buffers = std::make_shared<buffer_pool_t>(kPooledBufferSize,
+            context.config.network.buffers.capacity);
+    }
+
     m_asio->post(std::bind(&gc_action_t::operator(),
         std::make_shared<gc_action_t>(this, boost::posix_time::seconds(kCollectionInterval))
     ));
 
+    const auto& admission = context.config.network.admission;
+
+    for(auto it = admission.begin(); it != admission.end(); ++it) {
+        m_admission[it->first] = std::make_shared<admission_t>(
+            std::chrono::milliseconds(it->second.target),
+            std::chrono::milliseconds(it->second.interval)
+        );
+    }
+
+    if(!m_admission.empty()) {
+        m_probe = std::make_unique<asio::deadline_timer>(*m_asio);
+
+        m_asio->post(std::bind(&probe_action_t::operator(),
+            std::make_shared<probe_action_t>(this, std::chrono::milliseconds(kProbeInterval))
+        ));
+    }
+
     COCAINE_LOG_DEBUG(m_log, "engine started");
 }
 
@@ -123,9 +343,19 @@ execution_unit_t::~execution_unit_t() {
             it->second->detach(std::error_code());
         }
 
-        // NOTE: It's okay to destroy deadline timer here, because garbage collector always performs
-        // existence check for timer.
+        for(auto it = m_acceptors.begin(); it != m_acceptors.end(); ++it) {
+            std::error_code ec;
+
+            // Stop accepting new connections.
+            it->second->close(ec);
+        }
+
+        m_acceptors.clear();
+
+        // NOTE: It's okay to destroy deadline timers here, because both garbage collector and the
+        // load probe always perform existence check for their timers.
         m_cron.reset();
+        m_probe.reset();
     });
 
     // NOTE: This will block until all the outstanding operations are complete.
@@ -136,8 +366,6 @@ template<class Socket>
 std::shared_ptr<session<typename Socket::protocol_type>>
 execution_unit_t::attach(std::unique_ptr<Socket> ptr, const dispatch_ptr_t& dispatch) {
     typedef Socket socket_type;
-    typedef typename socket_type::protocol_type protocol_type;
-    typedef session<protocol_type> session_type;
 
     int fd;
 
@@ -145,24 +373,71 @@ execution_unit_t::attach(std::unique_ptr<Socket> ptr, const dispatch_ptr_t& disp
         throw std::system_error(errno, std::system_category(), "unable to clone client's socket");
     }
 
+    std::unique_ptr<socket_type> socket;
+
+    try {
+        // Copy the socket into the new reactor.
+        socket = std::make_unique<socket_type>(*m_asio, ptr->local_endpoint().protocol(), fd);
+    } catch(const std::system_error& e) {
+        ::close(fd);
+        throw std::system_error(e.code(), "client has disappeared while creating session");
+    }
+
+    return adopt(std::move(socket), dispatch);
+}
+
+template<class Socket>
+std::shared_ptr<session<typename Socket::protocol_type>>
+execution_unit_t::adopt(std::unique_ptr<Socket> ptr, const dispatch_ptr_t& dispatch) {
+    typedef typename Socket::protocol_type protocol_type;
+    typedef session<protocol_type> session_type;
+
+    const int fd = ptr->native_handle();
+
     std::shared_ptr<session_type> session_;
 
     try {
-        // Local endpoint address of the socket to be cloned.
+        // Local endpoint address of the socket.
         const auto endpoint = ptr->local_endpoint();
 
-        // Copy the socket into the new reactor.
-        auto transport = std::make_unique<io::transport<protocol_type>>(
-            std::make_unique<socket_type>(*m_asio, endpoint.protocol(), fd)
-        );
+        auto transport = std::make_unique<io::transport<protocol_type>>(std::move(ptr), m_buffers);
+
+        if(m_context.config.network.watermarks.high) {
+            transport->writer->bound(io::watermarks_t{
+                m_context.config.network.watermarks.high,
+                m_context.config.network.watermarks.low
+            });
+        }
+
+        if(m_context.config.network.huffman) {
+            transport->writer->enable_huffman();
+        }
+
+        if(dispatch) {
+            const auto it = m_context.config.network.corking.find(dispatch->name());
+
+            if(it != m_context.config.network.corking.end()) {
+                transport->writer->cork(io::corking_t{
+                    it->second.bytes,
+                    boost::posix_time::milliseconds(it->second.latency)
+                });
+            }
+        }
 
         std::string remote_endpoint;
 
+        // Only known for the remote clients.
+        std::string remote_address;
+
         if(std::is_same<protocol_type, ip::tcp>::value) {
             // Disable Nagle's algorithm, since most of the service clients do not send or receive
             // more than a couple of kilobytes of data.
             transport->socket->set_option(ip::tcp::no_delay(true));
-            remote_endpoint = boost::lexical_cast<std::string>(ptr->remote_endpoint());
+
+            const auto remote = transport->socket->remote_endpoint();
+
+            remote_endpoint = boost::lexical_cast<std::string>(remote);
+            remote_address  = address_of(remote);
         } else if(std::is_same<protocol_type, local::stream_protocol>::value) {
             remote_endpoint = boost::lexical_cast<std::string>(endpoint);
         } else {
@@ -178,6 +453,33 @@ execution_unit_t::attach(std::unique_ptr<Socket> ptr, const dispatch_ptr_t& disp
 
         // Create a new inactive session.
         session_ = std::make_shared<session_type>(std::move(log), std::move(transport), dispatch);
+
+        if(const auto recorder = m_context.recorder()) {
+            session_->record(*recorder);
+        }
+
+        if(dispatch) {
+            const auto it = m_admission.find(dispatch->name());
+
+            if(it != m_admission.end()) {
+                session_->regulate(it->second);
+            }
+        }
+
+        const auto& quota = m_context.config.network.quotas.session;
+
+        if(quota.channels || quota.rate) {
+            session_->limit(std::make_shared<io::quota_t>(quota.channels, quota.rate, quota.burst));
+        }
+
+        // NOTE: Local clients are not subject to the remote address quotas.
+        if(m_context.quotas() && !remote_address.empty()) {
+            session_->limit(m_context.quotas()->get(remote_address));
+        }
+
+        // NOTE: The session is accounted right away, so that the balancer sees it even before it's
+        // started, which matters for bursts of connections.
+        session_->account(m_load);
     } catch(const std::system_error& e) {
         throw std::system_error(e.code(), "client has disappeared while creating session");
     }
@@ -187,11 +489,78 @@ execution_unit_t::attach(std::unique_ptr<Socket> ptr, const dispatch_ptr_t& disp
     return session_;
 }
 
+void
+execution_unit_t::listen(const ip::tcp::endpoint& endpoint, const dispatch_ptr_t& dispatch) {
+#if defined(SO_REUSEPORT)
+    auto acceptor = std::make_shared<ip::tcp::acceptor>(*m_asio);
+
+    acceptor->open(endpoint.protocol());
+    acceptor->set_option(ip::tcp::acceptor::reuse_address(true));
+    acceptor->set_option(reuse_port(true));
+    acceptor->bind(endpoint);
+    acceptor->listen();
+
+    const auto name = dispatch->name();
+
+    m_asio->post([=] {
+        auto& ptr = m_acceptors[name];
+
+        if(ptr) {
+            std::error_code ec;
+            ptr->close(ec);
+        }
+
+        ptr = acceptor;
+
+        COCAINE_LOG_DEBUG(m_log, "accepting connections for service '%s' on %s", name, endpoint);
+
+        std::make_shared<accept_action_t>(this, acceptor, dispatch)->operator()();
+    });
+#else
+    throw std::system_error(std::make_error_code(std::errc::operation_not_supported),
+        "unable to share the service endpoint");
+#endif
+}
+
+void
+execution_unit_t::unlisten(const std::string& name) {
+    m_asio->post([=] {
+        const auto it = m_acceptors.find(name);
+
+        if(it == m_acceptors.end()) {
+            return;
+        }
+
+        std::error_code ec;
+
+        // Pending accept operation will be aborted.
+        it->second->close(ec);
+
+        m_acceptors.erase(it);
+    });
+}
+
 double
 execution_unit_t::utilization() const {
     return m_chamber->load_avg1();
 }
 
+auto
+execution_unit_t::load() const -> const load_t& {
+    return *m_load;
+}
+
+auto
+execution_unit_t::shed() const -> std::map<std::string, uint64_t> {
+    std::map<std::string, uint64_t> result;
+
+    for(auto it = m_admission.begin(); it != m_admission.end(); ++it) {
+        result[it->first] = it->second->shed();
+    }
+
+    return result;
+}
+
 template
 std::shared_ptr<session<ip::tcp>>
 execution_unit_t::attach(std::unique_ptr<ip::tcp::socket>, const dispatch_ptr_t&);
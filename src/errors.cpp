@@ -101,6 +101,16 @@ class dispatch_category_t:
             return "no dispatch has been assigned for channel";
         if(code == cocaine::error::dispatch_errors::uncaught_error)
             return "uncaught invocation exception";
+        if(code == cocaine::error::dispatch_errors::queue_overflow)
+            return "session write queue is full";
+        if(code == cocaine::error::dispatch_errors::deadline_expired)
+            return "invocation deadline has expired";
+        if(code == cocaine::error::dispatch_errors::service_overloaded)
+            return "service is overloaded, try again later";
+        if(code == cocaine::error::dispatch_errors::channel_quota_exceeded)
+            return "too many concurrent channels";
+        if(code == cocaine::error::dispatch_errors::rate_limit_exceeded)
+            return "message rate limit exceeded";
 
         return "cocaine.rpc.dispatch error";
     }
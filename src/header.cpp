@@ -103,6 +103,18 @@ init_data() {
     return data;
 }
 
+struct init_extension_t {
+    init_extension_t(header_extension_table_t::storage_t& _data) :
+        data(_data)
+    {}
+    template<class Header>
+    void
+    operator()(Header) {
+        data[boost::mpl::find<header_extension_table_t::headers_storage, Header>::type::pos::value] = headers::make_header<Header>();
+    }
+    header_extension_table_t::storage_t& data;
+};
+
 namespace header {
 
 bool data_t::operator==(const data_t& other) const {
@@ -128,11 +140,7 @@ void
 header_t::zone_t::rebind_header(header_t& header) {
     size_t cur_size = storage.size();
     storage.resize(cur_size + header.get_name().size + header.get_value().size);
-    memcpy(storage.data()+cur_size, header.get_name().blob, header.get_name().size);
-    header.name.blob = storage.data()+cur_size;
-    cur_size += header.get_name().size;
-    memcpy(storage.data()+cur_size, header.get_value().blob, header.get_value().size);
-    header.value.blob = storage.data()+cur_size;
+    header.rebind(storage.data()+cur_size);
 }
 
 void
@@ -148,6 +156,15 @@ header_t::zone_t::rebind_headers(std::vector<header_t>& headers) {
     }
 }
 
+void
+header_t::rebind(char* storage) {
+    memcpy(storage, name.blob, name.size);
+    name.blob = storage;
+    storage += name.size;
+    memcpy(storage, value.blob, value.size);
+    value.blob = storage;
+}
+
 bool
 header_t::operator==(const header_t& other) const {
     return name == other.name && value == other.value;
@@ -196,9 +213,123 @@ header_static_table_t::get_headers() {
     return storage;
 }
 
+const header_extension_table_t::storage_t&
+header_extension_table_t::get_headers() {
+    static const storage_t storage = [] {
+        storage_t data;
+        init_extension_t init(data);
+        boost::mpl::for_each<headers_storage>(init);
+        return data;
+    }();
+    return storage;
+}
+
+namespace {
+
+// FNV-1a, chained through the seed so that the name+value hash extends the name hash.
+size_t
+hash_data(const header::data_t& data, size_t seed = 14695981039346656037ull) {
+    for(size_t i = 0; i < data.size; ++i) {
+        seed = (seed ^ static_cast<unsigned char>(data.blob[i])) * 1099511628211ull;
+    }
+
+    // Mix the size in, so that name and value boundaries matter.
+    return (seed ^ data.size) * 1099511628211ull;
+}
+
+struct static_index_t {
+    header_table_t::index_t by_name;
+    header_table_t::index_t by_entry;
+
+    std::array<size_t, header_static_table_t::size> first_by_name;
+
+    static_index_t() {
+        const auto& storage = header_static_table_t::get_headers();
+
+        // Only the first occurrence is indexed, so that lookups return the lowest static index.
+        for(size_t idx = 0; idx < storage.size(); ++idx) {
+            const size_t name_hash = hash_data(storage[idx].get_name());
+            const size_t entry_hash = hash_data(storage[idx].get_value(), name_hash);
+
+            auto same_name = [&](uint64_t id) { return storage[id - 1].name_equal(storage[idx]); };
+            auto same_entry = [&](uint64_t id) { return storage[id - 1] == storage[idx]; };
+
+            if(const uint64_t id = by_name.find(name_hash, same_name)) {
+                first_by_name[idx] = id - 1;
+            } else {
+                by_name.insert(name_hash, idx + 1);
+                first_by_name[idx] = idx;
+            }
+
+            if(!by_entry.find(entry_hash, same_entry)) {
+                by_entry.insert(entry_hash, idx + 1);
+            }
+        }
+    }
+
+    static
+    const static_index_t&
+    instance() {
+        static const static_index_t index;
+        return index;
+    }
+};
+
+} // namespace
+
+size_t
+header_static_table_t::name_idx(size_t idx) {
+    return static_index_t::instance().first_by_name.at(idx);
+}
+
+header_table_t::index_t::index_t() {
+    slots.fill(slot_t{0, 0});
+}
+
+void
+header_table_t::index_t::insert(size_t hash, uint64_t id) {
+    size_t i = hash & (capacity - 1);
+
+    while(slots[i].id) {
+        i = (i + 1) & (capacity - 1);
+    }
+
+    slots[i] = slot_t{hash, id};
+}
+
+void
+header_table_t::index_t::erase(size_t hash, uint64_t id) {
+    size_t i = hash & (capacity - 1);
+
+    while(slots[i].id != id) {
+        if(!slots[i].id) {
+            return;
+        }
+
+        i = (i + 1) & (capacity - 1);
+    }
+
+    // Backward shift deletion, so that probe sequences stay unbroken without tombstones.
+    for(size_t j = (i + 1) & (capacity - 1); slots[j].id; j = (j + 1) & (capacity - 1)) {
+        const size_t home = slots[j].hash & (capacity - 1);
+
+        // The entry stays in place if its home slot is cyclically within (i, j].
+        if(i <= j ? (i < home && home <= j) : (i < home || home <= j)) {
+            continue;
+        }
+
+        slots[i] = slots[j];
+        i = j;
+    }
+
+    slots[i] = slot_t{0, 0};
+}
+
 header_table_t::header_table_t() :
     header_lower_bound(0),
     header_upper_bound(0),
+    pushed(0),
+    popped(0),
     data_lower_bound(0),
     data_lower_bound_end(0),
     data_upper_bound(0),
@@ -270,6 +401,8 @@ header_table_t::push(const header_t& result) {
     // Encode value of the name of the header (plain copy)
     std::memcpy(dest, result.name.blob, result.name.size);
 
+    const header::data_t name = {dest, result.name.size};
+
     // Adjust buffer pointer
     dest += result.name.size;
 
@@ -279,12 +412,25 @@ header_table_t::push(const header_t& result) {
     // Encode value of the value of the header (plain copy)
     std::memcpy(dest, result.value.blob, result.value.size);
 
+    const header::data_t value = {dest, result.value.size};
+
     // Adjust buffer pointer
     dest += result.value.size + http2_header_overhead;
 
     // Save header itself in header circular buffer (array) to make header navigation easier
     // It is guaranteed not to overwrite old data which is still in use, as size of dynamic table is limited.
-    headers[header_upper_bound] = result;
+    // The stored header refers to the table's own copy of the data, as the source might not outlive it.
+    headers[header_upper_bound] = header_t(name, value);
+
+    const size_t name_hash = hash_data(name);
+    const size_t entry_hash = hash_data(value, name_hash);
+
+    hashes[header_upper_bound] = std::make_pair(name_hash, entry_hash);
+
+    by_name.insert(name_hash, pushed + 1);
+    by_entry.insert(entry_hash, pushed + 1);
+
+    pushed++;
     header_upper_bound++;
     if(header_upper_bound >= headers.size()) {
         header_upper_bound = 0;
@@ -296,6 +442,11 @@ header_table_t::push(const header_t& result) {
 
 void
 header_table_t::pop() {
+    by_name.erase(hashes[header_lower_bound].first, popped + 1);
+    by_entry.erase(hashes[header_lower_bound].second, popped + 1);
+
+    popped++;
+
     size_t header_size = headers[header_lower_bound].http2_size();
     data_lower_bound+=header_size;
     if(data_lower_bound == data_lower_bound_end) {
@@ -309,31 +460,54 @@ header_table_t::pop() {
 }
 
 size_t
-header_table_t::find(const std::function<bool(const header_t&)> comp) {
-    auto it = std::find_if(header_static_table_t::get_headers().begin(), header_static_table_t::get_headers().end(), comp);
-    if(it != header_static_table_t::get_headers().end()) {
-        return it - header_static_table_t::get_headers().begin();
-    }
-    if(header_lower_bound <= header_upper_bound) {
-        auto dyn_it = std::find_if(headers.data() + header_lower_bound, headers.data() + header_upper_bound, comp);
-        if(dyn_it != headers.data() + header_upper_bound) {
-            return header_static_table_t::size + (dyn_it - (headers.data() + header_lower_bound));
-        }
-    } else {
-        auto dyn_it = std::find_if(headers.data(), headers.data() + header_upper_bound, comp);
-        if(dyn_it != headers.data() + header_upper_bound) {
-            return header_static_table_t::size + (dyn_it - headers.data());
-        }
-        dyn_it = std::find_if(headers.data() + header_lower_bound, headers.end(), comp);
-        if(dyn_it != headers.end()) {
-            return header_static_table_t::size + (dyn_it - (headers.data() + header_lower_bound));
-        }
+header_table_t::find_by_full_match(const header_t& header) const {
+    const size_t entry_hash = hash_data(header.value, hash_data(header.name));
+
+    const auto& storage = header_static_table_t::get_headers();
+
+    if(const uint64_t id = static_index_t::instance().by_entry.find(entry_hash, [&](uint64_t id) {
+        return storage[id - 1] == header;
+    })) {
+        return id - 1;
+    }
+
+    if(const uint64_t id = by_entry.find(entry_hash, [&](uint64_t id) {
+        return headers[(id - 1) % headers.size()] == header;
+    })) {
+        return header_static_table_t::size + (id - 1 - popped);
     }
+
+    return 0;
+}
+
+size_t
+header_table_t::find_by_name(const header_t& header) const {
+    const size_t name_hash = hash_data(header.name);
+
+    const auto& storage = header_static_table_t::get_headers();
+
+    if(const uint64_t id = static_index_t::instance().by_name.find(name_hash, [&](uint64_t id) {
+        return storage[id - 1].name_equal(header);
+    })) {
+        return id - 1;
+    }
+
+    if(const uint64_t id = by_name.find(name_hash, [&](uint64_t id) {
+        return headers[(id - 1) % headers.size()].name_equal(header);
+    })) {
+        return header_static_table_t::size + (id - 1 - popped);
+    }
+
     return 0;
 }
 
 const header_t&
 header_table_t::operator[](size_t idx) {
+    if(idx >= header_extension_table_t::offset &&
+       idx < header_extension_table_t::offset + header_extension_table_t::size)
+    {
+        return header_extension_table_t::get_headers()[idx - header_extension_table_t::offset];
+    }
     if(idx == 0 || idx > headers.size() + header_static_table_t::size) {
         throw std::out_of_range("Invalid index for header table");
     }
@@ -342,7 +516,7 @@ header_table_t::operator[](size_t idx) {
     }
     idx -= header_static_table_t::size;
     idx += header_lower_bound;
-    if(idx > headers.size()) {
+    if(idx >= headers.size()) {
         idx -= headers.size();
     }
     assert(header_upper_bound > header_lower_bound ?
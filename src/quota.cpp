@@ -0,0 +1,125 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/detail/quota.hpp"
+
+#include <algorithm>
+
+using namespace cocaine::io;
+
+namespace {
+
+// The address table isn't swept for the expired entries until it grows at least this big.
+const size_t minimum_sweep_threshold = 64;
+
+} // namespace
+
+quota_t::quota_t(size_t channels, unsigned int rate, unsigned int burst):
+    m_channels(channels),
+    m_period(rate ? std::chrono::nanoseconds(std::chrono::seconds(1)).count() / rate : 0),
+    m_tolerance(m_period * (std::max(burst, 1u) - 1)),
+    m_opened(0),
+    m_arrival(0)
+{ }
+
+bool
+quota_t::open() {
+    if(!m_channels) {
+        return true;
+    }
+
+    auto opened = m_opened.load(std::memory_order_relaxed);
+
+    do {
+        if(opened >= m_channels) {
+            return false;
+        }
+    } while(!m_opened.compare_exchange_weak(opened, opened + 1, std::memory_order_relaxed));
+
+    return true;
+}
+
+void
+quota_t::close(size_t count) {
+    if(m_channels) {
+        m_opened.fetch_sub(count, std::memory_order_relaxed);
+    }
+}
+
+bool
+quota_t::consume(clock_type::time_point now) {
+    if(!m_period) {
+        return true;
+    }
+
+    const int64_t timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        now.time_since_epoch()
+    ).count();
+
+    auto arrival = m_arrival.load(std::memory_order_relaxed);
+
+    do {
+        // NOTE: The bucket is empty once the next arrival time is further away than the burst.
+        if(arrival - timestamp > m_tolerance) {
+            return false;
+        }
+    } while(!m_arrival.compare_exchange_weak(arrival, std::max(arrival, timestamp) + m_period,
+        std::memory_order_relaxed));
+
+    return true;
+}
+
+quota_table_t::quota_table_t(size_t channels, unsigned int rate, unsigned int burst):
+    m_channels(channels),
+    m_rate(rate),
+    m_burst(burst),
+    m_sweep_threshold(minimum_sweep_threshold)
+{ }
+
+auto
+quota_table_t::get(const std::string& address) -> std::shared_ptr<quota_t> {
+    return m_quotas.apply([&](std::map<std::string, std::weak_ptr<quota_t>>& mapping) {
+        auto& weak = mapping[address];
+
+        if(auto quota = weak.lock()) {
+            return quota;
+        }
+
+        // NOTE: Entries of the addresses which have gone away are collected here, so that the table
+        // only grows with the number of the concurrently connected addresses. The table is only
+        // swept once it has doubled since the last sweep, so that it's amortized over the new ones.
+        if(mapping.size() >= m_sweep_threshold) {
+            for(auto it = mapping.begin(); it != mapping.end();) {
+                if(it->second.expired() && it->first != address) {
+                    it = mapping.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+
+            m_sweep_threshold = std::max<size_t>(mapping.size() * 2, minimum_sweep_threshold);
+        }
+
+        auto quota = std::make_shared<quota_t>(m_channels, m_rate, m_burst);
+        weak = quota;
+
+        return quota;
+    });
+}
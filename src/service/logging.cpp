@@ -25,6 +25,7 @@
 
 #include "cocaine/traits/attributes.hpp"
 #include "cocaine/traits/enum.hpp"
+#include "cocaine/traits/string_ref.hpp"
 #include "cocaine/traits/vector.hpp"
 
 using namespace cocaine;
@@ -66,7 +67,7 @@ logging_t::prototype() const -> const io::basic_dispatch_t& {
 }
 
 void
-logging_t::on_emit(logging::priorities level, std::string source, std::string message,
+logging_t::on_emit(logging::priorities level, std::string source, io::string_ref_t message,
                    attribute::set_t attributes)
 {
     auto record = wrapper->open_record(level, std::move(attributes));
@@ -74,7 +75,8 @@ logging_t::on_emit(logging::priorities level, std::string source, std::string me
     if(!record) return;
 
     record.insert(cocaine::logging::keyword::source() = std::move(source));
-    record.message(std::move(message));
+    // NOTE: The message is copied out of the session buffer only if the record passes the filter.
+    record.message(message.str());
 
     wrapper->push(std::move(record));
 }
@@ -22,23 +22,145 @@
 
 #include "cocaine/api/storage.hpp"
 
+#include "cocaine/context.hpp"
+#include "cocaine/logging.hpp"
+
 #include "cocaine/dynamic/dynamic.hpp"
 
+#include "cocaine/rpc/worker_pool.hpp"
+
+#include "cocaine/traits/string_ref.hpp"
+
+#include <asio/deadline_timer.hpp>
+
 using namespace cocaine::io;
 using namespace cocaine::service;
 
 namespace ph = std::placeholders;
 
+namespace {
+
+// Logs the worker pool stats every once in a while, as long as the pool is alive and busy.
+
+class stats_periodic_action_t:
+    public std::enable_shared_from_this<stats_periodic_action_t>
+{
+    const std::unique_ptr<cocaine::logging::log_t> log;
+    const std::weak_ptr<worker_pool_t> pool;
+
+    asio::deadline_timer timer;
+    const boost::posix_time::seconds interval;
+
+    // Counters at the last report, so that the idle pool isn't reported over and over again.
+    uint64_t completed;
+    uint64_t rejected;
+
+public:
+    template<class Interval>
+    stats_periodic_action_t(std::unique_ptr<cocaine::logging::log_t> log_,
+                            const std::shared_ptr<worker_pool_t>& pool_,
+                            asio::io_service& asio, Interval interval_)
+    :
+        log(std::move(log_)),
+        pool(pool_),
+        timer(asio),
+        interval(interval_),
+        completed(0),
+        rejected(0)
+    { }
+
+    void
+    operator()();
+
+private:
+    void
+    finalize(const std::error_code& ec);
+};
+
+void
+stats_periodic_action_t::operator()() {
+    timer.expires_from_now(interval);
+
+    timer.async_wait(std::bind(&stats_periodic_action_t::finalize,
+        shared_from_this(),
+        ph::_1
+    ));
+}
+
+void
+stats_periodic_action_t::finalize(const std::error_code& ec) {
+    if(ec == asio::error::operation_aborted) {
+        return;
+    }
+
+    const auto ptr = pool.lock();
+
+    if(!ptr) {
+        return;
+    }
+
+    const auto stats = ptr->stats();
+
+    const bool idle = !stats.pending && !stats.active && stats.completed == completed &&
+        stats.rejected == rejected;
+
+    if(!idle) {
+        COCAINE_LOG_INFO(log, "workers: %d pending, %d active, %d completed, %d rejected task(s)",
+            stats.pending, stats.active, stats.completed, stats.rejected);
+    }
+
+    completed = stats.completed;
+    rejected  = stats.rejected;
+
+    operator()();
+}
+
+} // namespace
+
 storage_t::storage_t(context_t& context, asio::io_service& asio, const std::string& name, const dynamic_t& args):
     category_type(context, asio, name, args),
     dispatch<storage_tag>(name)
 {
     const auto storage = api::storage(context, args.as_object().at("backend", "core").as_string());
 
-    on<storage::read>(std::bind(&api::storage_t::read, storage, ph::_1, ph::_2));
-    on<storage::write>(std::bind(&api::storage_t::write, storage, ph::_1, ph::_2, ph::_3, ph::_4));
-    on<storage::remove>(std::bind(&api::storage_t::remove, storage, ph::_1, ph::_2));
-    on<storage::find>(std::bind(&api::storage_t::find, storage, ph::_1, ph::_2));
+    typedef void (api::storage_t::*write_type)(const std::string&, const std::string&,
+        const string_ref_t&, const std::vector<std::string>&);
+
+    // NOTE: Writes are always handled by the engine threads, because the value is referenced right
+    // from the read buffer instead of being copied, so it can't outlive the invocation.
+    on<storage::write>(std::bind(static_cast<write_type>(&api::storage_t::write), storage,
+        ph::_1, ph::_2, ph::_3, ph::_4));
+
+    const auto offload = args.as_object().at("offload", dynamic_t::empty_object).as_object();
+
+    if(offload.empty()) {
+        on<storage::read>(std::bind(&api::storage_t::read, storage, ph::_1, ph::_2));
+        on<storage::remove>(std::bind(&api::storage_t::remove, storage, ph::_1, ph::_2));
+        on<storage::find>(std::bind(&api::storage_t::find, storage, ph::_1, ph::_2));
+
+        return;
+    }
+
+    const auto threads = offload.at("threads", 1).to<size_t>();
+    const auto limit   = offload.at("limit", 1024).to<size_t>();
+
+    if(!threads || !limit) {
+        throw cocaine::error_t("number of storage workers and their queue limit must be positive");
+    }
+
+    m_workers = std::make_shared<io::worker_pool_t>(name + "/workers", threads, limit);
+
+    asio.post(std::bind(&stats_periodic_action_t::operator(),
+        std::make_shared<stats_periodic_action_t>(context.log(name), m_workers, asio,
+            boost::posix_time::seconds(kStatsInterval))
+    ));
+
+    on<storage::read>(std::bind(&api::storage_t::read, storage, ph::_1, ph::_2),
+        io::offload(m_workers));
+    on<storage::remove>(std::bind(&api::storage_t::remove, storage, ph::_1, ph::_2),
+        io::offload(m_workers));
+    on<storage::find>(std::bind(&api::storage_t::find, storage, ph::_1, ph::_2),
+        io::offload(m_workers));
 }
 
 const basic_dispatch_t&
@@ -22,14 +22,22 @@
 
 #include "cocaine/logging.hpp"
 
+#include "cocaine/detail/admission.hpp"
+#include "cocaine/detail/balancer.hpp"
+#include "cocaine/detail/quota.hpp"
+
 #include "cocaine/rpc/asio/transport.hpp"
 
 #include "cocaine/rpc/dispatch.hpp"
 #include "cocaine/rpc/upstream.hpp"
 
+#include "cocaine/idl/primitive.hpp"
+
 #include <asio/ip/tcp.hpp>
 #include <asio/local/stream_protocol.hpp>
 
+#include <algorithm>
+
 using namespace cocaine;
 using namespace cocaine::io;
 
@@ -45,9 +53,16 @@ class session_t::pull_action_t:
     // Keeps the session alive until all the operations are complete.
     const std::shared_ptr<session_t> session;
 
+    // Maximum number of buffered messages handled in a single reactor turn.
+    static const size_t kBatchBudget = 64;
+
+    // Whether the first message, which carries the peer's advertisements, has been handled.
+    bool negotiated;
+
 public:
     pull_action_t(const std::shared_ptr<session_t>& session_):
-        session(session_)
+        session(session_),
+        negotiated(false)
     { }
 
     void
@@ -56,10 +71,21 @@ public:
 private:
     void
     finalize(const std::error_code& ec);
+
+    void
+    resume();
 };
 
 void
 session_t::pull_action_t::operator()(const std::shared_ptr<transport_type> ptr) {
+    if(ptr->writer->congested()) {
+        COCAINE_LOG_DEBUG(session->log, "suspending session due to write queue congestion");
+
+        // NOTE: Stop reading from the client until it drains the messages already queued for it, so
+        // that it can't make the session buffer arbitrary amounts of responses.
+        return ptr->writer->notify(std::bind(&pull_action_t::resume, shared_from_this()));
+    }
+
     ptr->reader->read(message, std::bind(&pull_action_t::finalize,
         shared_from_this(),
         std::placeholders::_1
@@ -83,18 +109,52 @@ session_t::pull_action_t::finalize(const std::error_code& ec) {
 #else
     if(const auto ptr = *session->transport.synchronize()) {
 #endif
-        try {
-            // NOTE: In case the underlying slot has miserably failed to handle its exceptions, the
-            // client will be disconnected to prevent any further damage to the service and himself.
-            session->handle(message);
-            message.clear();
-        } catch(const std::system_error& e) {
-            COCAINE_LOG_ERROR(session->log, "uncaught invocation exception: %s", error::to_string(e));
-            return session->detach(e.code());
-        } catch(const std::exception& e) {
-            COCAINE_LOG_ERROR(session->log, "uncaught invocation exception: %s", e.what());
-            return session->detach(error::uncaught_error);
-        }
+        size_t budget = kBatchBudget;
+
+        // NOTE: All the complete frames which are already in the read buffer are handled in one go,
+        // without going through the reactor queue for each of them. The budget keeps the reactor fair
+        // to other sessions in case of a continuous stream of pipelined messages.
+        do {
+            try {
+                // NOTE: In case the underlying slot has miserably failed to handle its exceptions,
+                // the client will be disconnected to prevent any further damage to the service and
+                // himself.
+                // NOTE: Peers advertise their support for Huffman coded header values on their own,
+                // usually with the very first message. Headers are only scanned for it until then,
+                // and only if it's enabled locally, as it's of no use otherwise.
+                if(ptr->writer->huffman_pending() &&
+                   message.meta<hpack::headers::huffman_coding<>>())
+                {
+                    ptr->writer->accept_huffman();
+                }
+
+                // NOTE: Peers advertise their support for the extension table with their very first
+                // message, so only that one is checked.
+                if(!negotiated) {
+                    if(message.meta<hpack::headers::extension_table<>>()) {
+                        ptr->writer->accept_extensions();
+                    }
+
+                    negotiated = true;
+                }
+
+                session->handle(message);
+                message.clear();
+            } catch(const std::system_error& e) {
+                COCAINE_LOG_ERROR(session->log, "uncaught invocation exception: %s", error::to_string(e));
+                return session->detach(e.code());
+            } catch(const std::exception& e) {
+                COCAINE_LOG_ERROR(session->log, "uncaught invocation exception: %s", e.what());
+                return session->detach(error::uncaught_error);
+            }
+
+            // NOTE: The session might have been detached while handling the message, in which case
+            // neither the rest of the batch is handled, nor the transport is cycled back.
+            if(session->is_detached()) {
+                COCAINE_LOG_DEBUG(session->log, "ignoring pending invocations due to detached session");
+                return;
+            }
+        } while(--budget && !ptr->writer->congested() && ptr->reader->try_read(message));
 
         // Cycle the transport back into the message pump.
         operator()(std::move(ptr));
@@ -103,68 +163,126 @@ session_t::pull_action_t::finalize(const std::error_code& ec) {
     }
 }
 
-class session_t::push_action_t:
-    public enable_shared_from_this<push_action_t>
-{
-    const encoder_t::message_type message;
+void
+session_t::pull_action_t::resume() {
+#if defined(__clang__)
+    if(const auto ptr = std::atomic_load(&session->transport)) {
+#else
+    if(const auto ptr = *session->transport.synchronize()) {
+#endif
+        COCAINE_LOG_DEBUG(session->log, "resuming session, write queue has been drained");
 
-    // Keeps the session alive until all the operations are complete.
+        operator()(std::move(ptr));
+    }
+}
+
+class session_t::drain_action_t {
+    // Keeps the session alive until the batch is written.
     const std::shared_ptr<session_t> session;
 
 public:
-    push_action_t(encoder_t::message_type&& message, const std::shared_ptr<session_t>& session_):
-        message(std::move(message)),
+    explicit
+    drain_action_t(const std::shared_ptr<session_t>& session_):
         session(session_)
     { }
 
     void
-    operator()(const std::shared_ptr<transport_type> ptr);
+    operator()();
+
+    // Asio handler allocation hooks, so that the operation is placed into the session storage.
+
+    friend
+    void*
+    asio_handler_allocate(std::size_t size, drain_action_t* action) {
+        return action->allocate(size);
+    }
+
+    friend
+    void
+    asio_handler_deallocate(void* ptr, std::size_t size, drain_action_t* action) {
+        action->deallocate(ptr, size);
+    }
 
 private:
+    void*
+    allocate(std::size_t size);
+
     void
-    finalize(const std::error_code& ec);
+    deallocate(void* ptr, std::size_t size);
 };
 
 void
-session_t::push_action_t::operator()(const std::shared_ptr<transport_type> ptr) {
-    if(!trace_t::current().empty()) {
-        if(trace_t::current().pushed()) {
-            COCAINE_LOG_INFO(session->log, "cs");
-        } else {
-            COCAINE_LOG_INFO(session->log, "ss");
+session_t::drain_action_t::operator()() {
+    session->outbox.apply([this](std::vector<outgoing_t>& queue) {
+        session->draining.swap(queue);
+    });
+
+#if defined(__clang__)
+    if(const auto ptr = std::atomic_load(&session->transport)) {
+#else
+    if(const auto ptr = *session->transport.synchronize()) {
+#endif
+        auto& batch = session->draining;
+
+        if(batch.empty()) {
+            return;
+        }
+
+        // NOTE: Write errors are reported to every pending message, so it's enough to watch the last
+        // one in the batch to detach the session.
+        if(!batch.back().handler) {
+            batch.back().handler = std::bind(&session_t::finalize, session, std::placeholders::_1);
+        }
+
+        try {
+            for(auto it = batch.begin(); it != batch.end(); ++it) {
+                ptr->writer->write(std::move(it->message), std::move(it->handler));
+            }
+        } catch(...) {
+            batch.clear();
+            throw;
         }
+    } else {
+        COCAINE_LOG_DEBUG(session->log, "dropping %d message(s) due to detached session",
+            session->draining.size());
     }
 
-    ptr->writer->write(message, trace_t::bind(&push_action_t::finalize,
-        shared_from_this(),
-        std::placeholders::_1
-    ));
+    session->draining.clear();
 }
 
-void
-session_t::push_action_t::finalize(const std::error_code& ec) {
-    COCAINE_LOG_ZIPKIN(session->log, "after send");
-    if(ec.value() == 0) return;
+void*
+session_t::drain_action_t::allocate(std::size_t size) {
+    if(size <= sizeof(session->drain_storage) && !session->drain_storage_used.exchange(true)) {
+        return &session->drain_storage;
+    }
 
-    if(ec != asio::error::eof) {
-        COCAINE_LOG_ERROR(session->log, "client disconnected: [%d] %s", ec.value(), ec.message());
+    return ::operator new(size);
+}
+
+void
+session_t::drain_action_t::deallocate(void* ptr, std::size_t) {
+    if(ptr == &session->drain_storage) {
+        session->drain_storage_used = false;
     } else {
-        COCAINE_LOG_DEBUG(session->log, "client disconnected");
+        ::operator delete(ptr);
     }
-
-    return session->detach(ec);
 }
 
 class session_t::channel_t
 {
 public:
-    channel_t(const dispatch_ptr_t& dispatch_, const upstream_ptr_t& upstream_):
+    channel_t(const dispatch_ptr_t& dispatch_, const upstream_ptr_t& upstream_, bool accounted_):
         dispatch(dispatch_),
-        upstream(upstream_)
+        upstream(upstream_),
+        accounted(accounted_)
     { }
 
     dispatch_ptr_t dispatch;
     upstream_ptr_t upstream;
+
+    // Whether the channel is accounted in the session quotas and the engine load, which is the case
+    // for the incoming channels.
+    const bool accounted;
 };
 
 // Session
@@ -173,7 +291,10 @@ session_t::session_t(std::unique_ptr<logging::log_t> log_, std::unique_ptr<trans
     log(std::move(log_)),
     transport(std::shared_ptr<transport_type>(std::move(transport_))),
     prototype(prototype_),
-    max_channel_id(0)
+    drain_storage_used(false),
+    max_channel_id(0),
+    recorder(nullptr),
+    endpoint(0)
 { }
 
 // Operations
@@ -182,53 +303,150 @@ void
 session_t::handle(const decoder_t::message_type& message) {
     const channel_map_t::key_type channel_id = message.span();
     boost::optional<trace_t> incoming_trace;
+    deadline_t deadline;
+
+    if(const auto deadline_header = message.meta<hpack::headers::deadline<>>()) {
+        deadline = deadline_t::after(std::chrono::microseconds(std::min<uint64_t>(
+            deadline_header->get_value().convert<uint64_t>(),
+            std::numeric_limits<int64_t>::max()
+        )));
+    }
 
+    // NOTE: Messages over the rate limit are only tolerated as long as they start new invocations,
+    // which can be cheaply rejected, otherwise the client is disconnected.
+    const auto throttled = !quotas.empty() && !std::all_of(quotas.begin(), quotas.end(),
+        std::bind(&quota_t::consume, std::placeholders::_1, quota_t::clock_type::now()));
+
+    // Set if the invocation is rejected before it's handled.
+    std::error_code rejection;
+
+    // NOTE: Only the table lookup itself is done under the lock, which is a single probe most of
+    // the time, so that forks and revocations from other threads don't stall the message pump.
     const auto channel = channels.apply([&](channel_map_t& mapping) -> std::shared_ptr<channel_t> {
-        channel_map_t::const_iterator lb, ub;
+        if(const auto ptr = mapping.find(channel_id)) {
+            if(throttled) {
+                throw std::system_error(error::rate_limit_exceeded);
+            }
 
-        std::tie(lb, ub) = mapping.equal_range(channel_id);
+            // NOTE: The virtual channel pointer is copied here to avoid data races.
+            return *ptr;
+        }
+
+        if(channel_id <= max_channel_id) {
+            const auto range = std::upper_bound(rejected.begin(), rejected.end(), channel_id,
+                [](uint64_t id, const std::pair<uint64_t, uint64_t>& ids) {
+                    return id < ids.first;
+                });
 
-        if(lb == ub) {
-            if(channel_id <= max_channel_id) {
-                // NOTE: Checking whether channel number is always higher than the previous channel
-                // number is similar to an infinite TIME_WAIT timeout for TCP sockets. It might be
-                // not the best approach, but since we have 2^64 possible channels it's good enough.
-                throw std::system_error(error::revoked_channel, std::to_string(channel_id));
+            if(range != rejected.begin() && channel_id <= std::prev(range)->second) {
+                // NOTE: Clients might have pipelined more messages after an invocation which has
+                // been rejected. They are dropped, as the client is going to get an error anyway.
+                return nullptr;
             }
 
-            std::tie(lb, std::ignore) = mapping.insert({channel_id, std::make_shared<channel_t>(
-                prototype,
-                // Do not store trace if we handling server side.
-                std::make_shared<basic_upstream_t>(shared_from_this(), channel_id, boost::none)
-            )});
+            // NOTE: Checking whether channel number is always higher than the previous channel
+            // number is similar to an infinite TIME_WAIT timeout for TCP sockets. It might be not
+            // the best approach, but since we have 2^64 possible channels it's good enough.
+            throw std::system_error(error::revoked_channel, std::to_string(channel_id));
+        }
 
-            max_channel_id = channel_id;
+        const auto previous_id = max_channel_id;
+
+        max_channel_id = channel_id;
+
+        // NOTE: Invocations which have expired before they could be handled, which exceed the client
+        // quotas or which arrive while the engine is overloaded are rejected even before their
+        // arguments are unpacked. The client would wait forever for the invocations which slots
+        // have no way to report an error, so those are never shed, and exceeding the quotas with
+        // them disconnects the client.
+        const bool reportable = rejectable(message.type());
+
+        if(reportable && deadline.expired()) {
+            rejection = error::deadline_expired;
+        } else if(throttled) {
+            rejection = error::rate_limit_exceeded;
+        } else if(reportable && admission && !admission->admit()) {
+            rejection = error::service_overloaded;
+        } else if(!acquire()) {
+            rejection = error::channel_quota_exceeded;
         }
-        if(lb->second->upstream->client_trace) {
-            incoming_trace = lb->second->upstream->client_trace;
-        } else {
-            auto trace_header = message.meta<hpack::headers::trace_id<>>();
-            auto span_header = message.meta<hpack::headers::span_id<>>();
-            auto parent_header = message.meta<hpack::headers::parent_id<>>();
-            if(trace_header && span_header && parent_header) {
-                incoming_trace = trace_t(
-                    trace_header->get_value().convert<uint64_t>(),
-                    span_header->get_value().convert<uint64_t>(),
-                    parent_header->get_value().convert<uint64_t>(),
-                    std::get<0>(lb->second->dispatch->root().at(message.type()))
-                );
+
+        if(rejection) {
+            if(!reportable) {
+                throw std::system_error(rejection);
             }
+
+            if(!rejected.empty() && rejected.back().second == previous_id) {
+                rejected.back().second = channel_id;
+            } else {
+                rejected.emplace_back(channel_id, channel_id);
+            }
+
+            // NOTE: Only the channels rejected long ago are forgotten, and only if the client has
+            // been shed on and off many times since then.
+            if(rejected.size() > kMaximumRejectedRanges) {
+                rejected.pop_front();
+            }
+
+            return nullptr;
         }
 
-        // NOTE: The virtual channel pointer is copied here to avoid data races.
-        return lb->second;
+        return mapping.insert(channel_id, std::make_shared<channel_t>(
+            prototype,
+            // Do not store trace if we handling server side.
+            std::make_shared<basic_upstream_t>(shared_from_this(), channel_id, boost::none),
+            true
+        ));
     });
 
+    if(!channel) {
+        if(rejection) {
+            reject(channel_id, message.type(), rejection);
+        }
+
+        return;
+    }
+
     if(!channel->dispatch) {
         throw std::system_error(error::unbound_dispatch);
     }
 
+    if(channel->upstream->client_trace) {
+        incoming_trace = channel->upstream->client_trace;
+    } else if(auto context_header = message.meta<hpack::headers::trace_context<>>()) {
+        const auto value = context_header->get_value();
+
+        if(value.size != sizeof(uint64_t) * 3) {
+            throw std::system_error(std::make_error_code(std::errc::invalid_argument),
+                "invalid trace context header size");
+        }
+
+        uint64_t context[3] = { 0, 0, 0 };
+
+        // NOTE: The ids are packed in the network byte order.
+        for(size_t i = 0; i < value.size; ++i) {
+            context[i / 8] = (context[i / 8] << 8) | static_cast<unsigned char>(value.blob[i]);
+        }
+
+        incoming_trace = trace_t(context[0], context[1], context[2],
+            std::get<0>(channel->dispatch->root().at(message.type())));
+    } else {
+        // NOTE: Peers which predate the compact trace context still send the ids separately.
+        auto trace_header = message.meta<hpack::headers::trace_id<>>();
+        auto span_header = message.meta<hpack::headers::span_id<>>();
+        auto parent_header = message.meta<hpack::headers::parent_id<>>();
+        if(trace_header && span_header && parent_header) {
+            incoming_trace = trace_t(
+                trace_header->get_value().convert<uint64_t>(),
+                span_header->get_value().convert<uint64_t>(),
+                parent_header->get_value().convert<uint64_t>(),
+                std::get<0>(channel->dispatch->root().at(message.type()))
+            );
+        }
+    }
+
     trace_t::restore_scope_t trace_scope(incoming_trace);
+    deadline_t::scope_t deadline_scope(deadline);
 
     COCAINE_LOG_DEBUG(log, "invocation type %llu: '%s' in channel %llu, dispatch: '%s'",
         message.type(),
@@ -240,10 +458,10 @@ session_t::handle(const decoder_t::message_type& message) {
 
     if(!trace_t::current().empty()) {
         if(trace_t::current().pushed()) {
-            COCAINE_LOG_INFO(log, "cr");
+            annotate(span_recorder_t::client_receive);
             trace_t::current().pop();
         } else {
-            COCAINE_LOG_INFO(log, "sr");
+            annotate(span_recorder_t::server_receive);
         }
     }
 
@@ -257,35 +475,116 @@ session_t::handle(const decoder_t::message_type& message) {
     }
 }
 
+bool
+session_t::rejectable(uint64_t type) const {
+    typedef io::primitive<boost::mpl::list<>::type>::error error_type;
+
+    const auto& root = prototype->root();
+    const auto it = root.find(type);
+
+    if(it == root.end() || !std::get<2>(it->second)) {
+        return false;
+    }
+
+    const auto& protocol = std::get<2>(it->second).get();
+    const auto error = protocol.find(event_traits<error_type>::id);
+
+    return error != protocol.end() && std::get<0>(error->second) == error_type::alias();
+}
+
+void
+session_t::reject(uint64_t channel_id, uint64_t type, const std::error_code& ec) {
+    // NOTE: Rejected invocations never reach their slots, so the error is sent on their behalf.
+    typedef io::primitive<boost::mpl::list<>::type>::error error_type;
+
+    COCAINE_LOG_DEBUG(log, "rejecting invocation type %llu in channel %llu: %s", type, channel_id,
+        ec.message());
+
+    push(encoded<error_type>(channel_id, ec, ec.message()));
+}
+
 void
 session_t::revoke(uint64_t channel_id) {
     channels.apply([&](channel_map_t& mapping) {
-        auto it = mapping.find(channel_id);
+        const auto ptr = mapping.find(channel_id);
 
-        if(it == mapping.end()) {
+        if(!ptr) {
             COCAINE_LOG_WARNING(log, "ignoring revoke request for channel %d", channel_id);
             return;
         }
 
-        if(it->second->dispatch) {
+        if((*ptr)->dispatch) {
             COCAINE_LOG_ERROR(log, "revoking channel %d, dispatch: '%s'", channel_id,
-                it->second->dispatch->name());
-            it->second->dispatch->discard(std::error_code());
+                (*ptr)->dispatch->name());
+            (*ptr)->dispatch->discard(std::error_code());
         } else {
             COCAINE_LOG_DEBUG(log, "revoking channel %d", channel_id);
         }
 
-        mapping.erase(it);
+        if((*ptr)->accounted) {
+            release(1);
+        }
+
+        mapping.erase(channel_id);
     });
 }
 
+bool
+session_t::acquire() {
+    for(auto it = quotas.begin(); it != quotas.end(); ++it) {
+        if(!(*it)->open()) {
+            std::for_each(quotas.begin(), it, std::bind(&quota_t::close, std::placeholders::_1, 1));
+            return false;
+        }
+    }
+
+    if(load) {
+        load->channels++;
+    }
+
+    return true;
+}
+
+void
+session_t::release(size_t count) {
+    std::for_each(quotas.begin(), quotas.end(), std::bind(&quota_t::close, std::placeholders::_1,
+        count));
+
+    if(load) {
+        load->channels -= count;
+    }
+}
+
+void
+session_t::regulate(const std::shared_ptr<admission_t>& admission_) {
+    admission = admission_;
+}
+
+void
+session_t::record(span_recorder_t& recorder_) {
+    recorder = &recorder_;
+    endpoint = trace_t::intern(name());
+}
+
+void
+session_t::limit(const std::shared_ptr<quota_t>& quota) {
+    quotas.push_back(quota);
+}
+
+void
+session_t::account(const std::shared_ptr<load_t>& load_) {
+    load = load_;
+    load->sessions++;
+}
+
 upstream_ptr_t
 session_t::fork(const dispatch_ptr_t& dispatch) {
     return channels.apply([&](channel_map_t& mapping) -> upstream_ptr_t {
         const auto channel_id = ++max_channel_id;
         auto trace = trace_t::current();
         trace.push(dispatch->name());
-        const auto downstream = std::make_shared<basic_upstream_t>(shared_from_this(), channel_id, trace);
+        const auto downstream = std::make_shared<basic_upstream_t>(shared_from_this(), channel_id, trace,
+            deadline_t::current());
 
         COCAINE_LOG_DEBUG(log, "forking new channel %d, dispatch: '%s'", channel_id,
             dispatch ? dispatch->name() : "<none>");
@@ -293,7 +592,7 @@ session_t::fork(const dispatch_ptr_t& dispatch) {
         if(dispatch) {
             // NOTE: For mute slots, creating a new channel will essentially leak memory, since no
             // response will ever be sent back, therefore the channel will never be revoked at all.
-            mapping.insert({channel_id, std::make_shared<channel_t>(dispatch, downstream)});
+            mapping.insert(channel_id, std::make_shared<channel_t>(dispatch, downstream, false));
         }
 
         return downstream;
@@ -326,16 +625,64 @@ session_t::push(encoder_t::message_type&& message) {
 #else
     if(const auto ptr = *transport.synchronize()) {
 #endif
-        // Use dispatch() instead of a direct call for thread safety.
-        ptr->socket->get_io_service().dispatch(trace_t::bind(&push_action_t::operator(),
-            std::make_shared<push_action_t>(std::move(message), shared_from_this()),
-            ptr
-        ));
+        if(ptr->writer->congested()) {
+            throw std::system_error(error::queue_overflow);
+        }
+
+        std::function<void(const std::error_code&)> handler;
+
+        if(!trace_t::current().empty()) {
+            if(trace_t::current().pushed()) {
+                annotate(span_recorder_t::client_send);
+            } else {
+                annotate(span_recorder_t::server_send);
+            }
+
+            if(!recorder) {
+                handler = trace_t::bind(&session_t::finalize, shared_from_this(),
+                    std::placeholders::_1);
+            }
+        }
+
+        const bool scheduled = outbox.apply([&](std::vector<outgoing_t>& queue) -> bool {
+            queue.push_back(outgoing_t{std::move(message), std::move(handler)});
+
+            // The batch is already scheduled unless this is the first message in the queue.
+            return queue.size() > 1;
+        });
+
+        if(!scheduled) {
+            // Use dispatch() instead of a direct call for thread safety.
+            ptr->socket->get_io_service().dispatch(drain_action_t(shared_from_this()));
+        }
     } else {
         throw std::system_error(error::not_connected);
     }
 }
 
+void
+session_t::annotate(span_recorder_t::annotation_t annotation) {
+    if(recorder) {
+        recorder->record(trace_t::current(), endpoint, annotation);
+    } else {
+        COCAINE_LOG_INFO(log, "%s", span_recorder_t::describe(annotation));
+    }
+}
+
+void
+session_t::finalize(const std::error_code& ec) {
+    COCAINE_LOG_ZIPKIN(log, "after send");
+    if(ec.value() == 0) return;
+
+    if(ec != asio::error::eof) {
+        COCAINE_LOG_ERROR(log, "client disconnected: [%d] %s", ec.value(), ec.message());
+    } else {
+        COCAINE_LOG_DEBUG(log, "client disconnected");
+    }
+
+    return detach(ec);
+}
+
 void
 session_t::detach(const std::error_code& ec) {
 #if defined(__clang__)
@@ -343,8 +690,12 @@ session_t::detach(const std::error_code& ec) {
 #else
     if(auto swapped = std::move(*transport.synchronize())) {
 #endif
+        const auto stats = swapped->writer->stats();
+
         swapped = nullptr;
-        COCAINE_LOG_DEBUG(log, "detached session from the transport");
+
+        COCAINE_LOG_DEBUG(log, "detached session from the transport, sent %d message(s) in %d syscall(s)",
+            stats.messages, stats.syscalls);
     } else {
         COCAINE_LOG_WARNING(log, "ignoring detach request for session");
         return;
@@ -357,12 +708,21 @@ session_t::detach(const std::error_code& ec) {
             COCAINE_LOG_DEBUG(log, "discarding %d channel dispatch(es)", mapping.size());
         }
 
-        for(auto it = mapping.begin(); it != mapping.end(); ++it) {
-            if(it->second->dispatch) it->second->dispatch->discard(ec);
-        }
+        size_t accounted = 0;
+
+        mapping.for_each([&](uint64_t, const std::shared_ptr<channel_t>& channel) {
+            if(channel->dispatch) channel->dispatch->discard(ec);
+            if(channel->accounted) accounted++;
+        });
+
+        release(accounted);
 
         mapping.clear();
     });
+
+    if(load) {
+        load->sessions--;
+    }
 }
 
 // Information
@@ -372,9 +732,9 @@ session_t::active_channels() const {
     return channels.apply([](const channel_map_t& mapping) -> std::map<uint64_t, std::string> {
         std::map<uint64_t, std::string> result;
 
-        for(auto it = mapping.begin(); it != mapping.end(); ++it) {
-            result[it->first] = it->second->dispatch ? it->second->dispatch->name() : "<none>";
-        }
+        mapping.for_each([&](uint64_t channel_id, const std::shared_ptr<channel_t>& channel) {
+            result[channel_id] = channel->dispatch ? channel->dispatch->name() : "<none>";
+        });
 
         return result;
     });
@@ -393,6 +753,15 @@ session_t::memory_pressure() const {
     }
 }
 
+bool
+session_t::is_detached() const {
+#if defined(__clang__)
+    return !std::atomic_load(&transport);
+#else
+    return !*transport.synchronize();
+#endif
+}
+
 std::string
 session_t::name() const {
     return prototype ? prototype->name() : "<none>";
@@ -77,6 +77,13 @@ files_t::read(const std::string& collection, const std::string& key) {
 void
 files_t::write(const std::string& collection, const std::string& key, const std::string& blob,
                const std::vector<std::string>& tags)
+{
+    write(collection, key, io::string_ref_t(blob), tags);
+}
+
+void
+files_t::write(const std::string& collection, const std::string& key, const io::string_ref_t& blob,
+               const std::vector<std::string>& tags)
 {
     std::lock_guard<std::mutex> guard(m_mutex);
 
@@ -130,7 +137,7 @@ files_t::write(const std::string& collection, const std::string& key, const std:
         fs::create_symlink(file_path, tag_path / key);
     }
 
-    stream.write(blob.c_str(), blob.size());
+    stream.write(blob.data(), blob.size());
     stream.close();
 }
 
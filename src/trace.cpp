@@ -22,25 +22,142 @@
 
 #include "cocaine/errors.hpp"
 
+#include <array>
+#include <atomic>
+#include <mutex>
 #include <random>
-#include <sstream>
-
-#include <boost/thread/tss.hpp>
+#include <unordered_map>
 
 using namespace cocaine;
 
-trace_t::trace_t():
-    trace_id(zero_value),
-    state({zero_value, zero_value, {}})
-{}
+namespace {
+
+// Append-only name table. Names are stored in chunks which are never moved nor freed, so lookups
+// are lock-free, only interning a new name takes the lock.
+class name_table_t {
+    static const size_t chunk_size = 256;
+    static const size_t chunk_count = 256;
+
+    typedef std::array<std::string, chunk_size> chunk_t;
+
+public:
+    name_table_t():
+        size(1)
+    {
+        for(auto it = chunks.begin(); it != chunks.end(); ++it) {
+            it->store(nullptr, std::memory_order_relaxed);
+        }
+
+        // Name 0 is reserved for the empty name.
+        chunks[0].store(new chunk_t(), std::memory_order_release);
+    }
+
+    trace_t::name_t
+    intern(const std::string& name) {
+        std::lock_guard<std::mutex> guard(mutex);
+
+        const auto it = ids.find(name);
+
+        if(it != ids.end()) {
+            return it->second;
+        }
+
+        const auto id = size.load(std::memory_order_relaxed);
+
+        if(id == chunk_size * chunk_count) {
+            // NOTE: Services don't have anywhere near that many distinct methods, so this is most
+            // likely a misbehaving client. Its traces will be logged without an rpc name.
+            return 0;
+        }
+
+        if(id % chunk_size == 0) {
+            chunks[id / chunk_size].store(new chunk_t(), std::memory_order_release);
+        }
+
+        (*chunks[id / chunk_size].load(std::memory_order_relaxed))[id % chunk_size] = name;
+
+        ids.insert(std::make_pair(name, id));
+        size.store(id + 1, std::memory_order_release);
+
+        return id;
+    }
+
+    const std::string&
+    lookup(trace_t::name_t id) const {
+        if(id >= size.load(std::memory_order_acquire)) {
+            return (*chunks[0].load(std::memory_order_acquire))[0];
+        }
+
+        return (*chunks[id / chunk_size].load(std::memory_order_acquire))[id % chunk_size];
+    }
+
+private:
+    std::array<std::atomic<chunk_t*>, chunk_count> chunks;
+    std::atomic<trace_t::name_t> size;
+
+    std::mutex mutex;
+    std::unordered_map<std::string, trace_t::name_t> ids;
+};
+
+name_table_t&
+name_table() {
+    // NOTE: Intentionally leaked, so that names can be looked up while other static objects and
+    // thread-local storage are being destroyed.
+    static name_table_t* table = new name_table_t();
+    return *table;
+}
+
+// Per-thread cache of recently interned names, keyed by the address of the name. Service method
+// names live in the dispatch graphs for the lifetime of the service, so most of the lookups end up
+// here. Entries are validated by content, since an address can be reused for a different name.
+struct name_cache_entry_t {
+    const std::string* key;
+    trace_t::name_t id;
+};
+
+thread_local std::array<name_cache_entry_t, 64> name_cache;
+
+// Per-thread xorshift128+ generator, it's much cheaper than sharing a Mersenne Twister between all
+// the threads, and is good enough for span ids.
+class id_generator_t {
+public:
+    id_generator_t() {
+        std::random_device device;
+
+        do {
+            state[0] = static_cast<uint64_t>(device()) << 32 | device();
+            state[1] = static_cast<uint64_t>(device()) << 32 | device();
+        } while(state[0] == 0 && state[1] == 0);
+    }
+
+    uint64_t
+    operator()() {
+        uint64_t x = state[0];
+        const uint64_t y = state[1];
+
+        state[0] = y;
+        x ^= x << 23;
+        state[1] = x ^ y ^ (x >> 17) ^ (y >> 26);
+
+        return state[1] + y;
+    }
+
+private:
+    uint64_t state[2];
+};
+
+thread_local trace_t current_trace;
+
+} // namespace
 
 trace_t::trace_t(uint64_t trace_id_,
                  uint64_t span_id_,
                  uint64_t parent_id_,
                  const std::string& rpc_name_):
     trace_id(trace_id_),
-    state({span_id_, parent_id_, rpc_name_}),
-    previous_state(boost::none)
+    state{span_id_, parent_id_, intern(rpc_name_)},
+    previous_state{zero_value, zero_value, 0},
+    is_pushed(false)
 {
     auto check_range = [](uint64_t value) -> bool {
         static const uint64_t max = (1ull << 63) - 1;
@@ -71,13 +188,32 @@ trace_t::generate(const std::string& rpc_name) {
     return trace_t(t_id, t_id, zero_value, rpc_name);
 }
 
+trace_t::name_t
+trace_t::intern(const std::string& name) {
+    if(name.empty()) {
+        return 0;
+    }
+
+    auto& entry = name_cache[(reinterpret_cast<uintptr_t>(&name) >> 4) % name_cache.size()];
+
+    if(entry.key == &name && name_table().lookup(entry.id) == name) {
+        return entry.id;
+    }
+
+    entry.key = &name;
+    entry.id  = name_table().intern(name);
+
+    return entry.id;
+}
+
+const std::string&
+trace_t::name(name_t id) {
+    return name_table().lookup(id);
+}
+
 trace_t&
 trace_t::current() {
-    static boost::thread_specific_ptr<trace_t> t;
-    if(t.get() == nullptr) {
-        t.reset(new trace_t());
-    }
-    return *t.get();
+    return current_trace;
 }
 
 uint64_t
@@ -95,6 +231,16 @@ trace_t::get_id() const {
     return state.span_id;
 }
 
+const std::string&
+trace_t::get_rpc_name() const {
+    return name(state.rpc_name);
+}
+
+trace_t::name_t
+trace_t::get_rpc_name_id() const {
+    return state.rpc_name;
+}
+
 bool
 trace_t::empty() const {
     return trace_id == zero_value;
@@ -106,9 +252,9 @@ trace_t::pop() {
         return;
     }
     BOOST_ASSERT_MSG(state.parent_id != zero_value, "cannot pop trace - parent_id is 0");
-    BOOST_ASSERT_MSG(previous_state.is_initialized(), "cannot pop trace - pushed state is none");
-    state = previous_state.get();
-    previous_state = boost::none;
+    BOOST_ASSERT_MSG(is_pushed, "cannot pop trace - pushed state is none");
+    state = previous_state;
+    is_pushed = false;
 }
 
 void
@@ -117,30 +263,43 @@ trace_t::push(const std::string& new_rpc_name) {
         return;
     }
     previous_state = state;
+    is_pushed = true;
     state.span_id = generate_id();
-    state.parent_id = previous_state->span_id;
-    state.rpc_name = new_rpc_name;
+    state.parent_id = previous_state.span_id;
+    state.rpc_name = intern(new_rpc_name);
 }
 
 bool
 trace_t::pushed() const {
-    return previous_state.is_initialized();
+    return is_pushed;
 }
 
 uint64_t
 trace_t::generate_id() {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
+    static thread_local id_generator_t generator;
+
+    uint64_t id;
+
     // Stupid zipkin-web can not handle unsigned ids. So we limit to signed diapason.
-    static std::uniform_int_distribution<uint64_t> dis(1, std::numeric_limits<uint64_t>::max()/2-1);
-    return dis(gen);
+    do {
+        id = generator() >> 1;
+    } while(id == zero_value);
+
+    return id;
 }
 
 std::string
 trace_t::to_hex_string(uint64_t value) {
-    std::ostringstream oss;
-    oss << std::hex << value;
-    return oss.str();
+    static const char digits[] = "0123456789abcdef";
+
+    char buffer[16];
+    char* it = buffer + sizeof(buffer);
+
+    do {
+        *--it = digits[value & 0xF];
+    } while(value >>= 4);
+
+    return std::string(it, buffer + sizeof(buffer));
 }
 
 trace_t::restore_scope_t::restore_scope_t(const boost::optional<trace_t>& new_trace) :
@@ -0,0 +1,327 @@
+/*
+    Copyright (c) 2011-2015 Anton Matveenko <antmat@yandex-team.ru>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/trace/recorder.hpp"
+
+#include "cocaine/context.hpp"
+#include "cocaine/logging.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+
+using namespace cocaine;
+
+// Single producer, single consumer ring buffer. The owning thread records annotations, the export
+// thread drains them.
+
+struct span_recorder_t::ring_t {
+    ring_t(size_t capacity):
+        events(capacity),
+        mask(capacity - 1),
+        head(0),
+        tail(0),
+        dropped(0)
+    { }
+
+    bool
+    push(const event_t& event) {
+        const auto position = tail.load(std::memory_order_relaxed);
+
+        if(position - head.load(std::memory_order_acquire) > mask) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        events[position & mask] = event;
+        tail.store(position + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    size_t
+    drain(std::vector<event_t>& target) {
+        const auto first = head.load(std::memory_order_relaxed);
+        const auto last  = tail.load(std::memory_order_acquire);
+
+        for(auto it = first; it != last; ++it) {
+            target.push_back(events[it & mask]);
+        }
+
+        head.store(last, std::memory_order_release);
+
+        return dropped.exchange(0, std::memory_order_relaxed);
+    }
+
+    std::vector<event_t> events;
+    const size_t mask;
+
+    // NOTE: Producer and consumer positions are kept on separate cache lines to avoid false sharing
+    // between the recording and the exporting threads.
+    std::atomic<size_t> head;
+    char padding[64];
+    std::atomic<size_t> tail;
+    std::atomic<size_t> dropped;
+};
+
+namespace {
+
+std::atomic<uint64_t> recorder_counter(0);
+
+uint64_t
+timestamp() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+}
+
+size_t
+round_up(size_t value) {
+    size_t result = 1;
+
+    while(result < value) {
+        result <<= 1;
+    }
+
+    return result;
+}
+
+struct hex_t {
+    uint64_t value;
+
+    friend
+    std::ostream&
+    operator<<(std::ostream& stream, const hex_t& hex) {
+        static const char digits[] = "0123456789abcdef";
+
+        char buffer[16];
+
+        for(size_t i = 0; i < sizeof(buffer); ++i) {
+            buffer[i] = digits[(hex.value >> (60 - i * 4)) & 0xF];
+        }
+
+        return stream.write(buffer, sizeof(buffer));
+    }
+};
+
+struct quoted_t {
+    const std::string& value;
+
+    friend
+    std::ostream&
+    operator<<(std::ostream& stream, const quoted_t& quoted) {
+        static const char digits[] = "0123456789abcdef";
+
+        stream << '"';
+
+        for(auto it = quoted.value.begin(); it != quoted.value.end(); ++it) {
+            const auto c = static_cast<unsigned char>(*it);
+
+            if(c == '"' || c == '\\') {
+                stream << '\\' << *it;
+            } else if(c < 0x20) {
+                stream << "\\u00" << digits[c >> 4] << digits[c & 0xF];
+            } else {
+                stream << *it;
+            }
+        }
+
+        return stream << '"';
+    }
+};
+
+} // namespace
+
+const char*
+span_recorder_t::describe(annotation_t annotation) {
+    switch(annotation) {
+    case client_send:
+        return "cs";
+    case client_receive:
+        return "cr";
+    case server_send:
+        return "ss";
+    case server_receive:
+        return "sr";
+    }
+
+    return "<unknown>";
+}
+
+span_recorder_t::span_recorder_t(context_t& context):
+    m_log(context.log("core/tracing")),
+    m_id(++recorder_counter),
+    m_threshold(static_cast<uint64_t>(context.config.tracing.sample * ((1ull << 63) - 1))),
+    m_path(context.config.tracing.path),
+    m_interval(context.config.tracing.interval),
+    m_capacity(round_up(context.config.tracing.buffer)),
+    m_stopped(false)
+{
+    m_thread = std::thread(&span_recorder_t::run, this);
+
+    COCAINE_LOG_INFO(m_log, "recording %.2f%% of the traces to '%s'",
+        context.config.tracing.sample * 100, m_path);
+}
+
+span_recorder_t::~span_recorder_t() {
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_stopped = true;
+    }
+
+    m_condition.notify_one();
+
+    // NOTE: The export thread flushes everything recorded so far before exiting.
+    m_thread.join();
+}
+
+void
+span_recorder_t::record(const trace_t& trace, trace_t::name_t endpoint, annotation_t annotation) {
+    if(!sampled(trace.get_trace_id())) {
+        return;
+    }
+
+    ring().push(event_t{
+        trace.get_trace_id(),
+        trace.get_id(),
+        trace.get_parent_id(),
+        timestamp(),
+        trace.get_rpc_name_id(),
+        endpoint,
+        annotation
+    });
+}
+
+void
+span_recorder_t::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while(!m_stopped) {
+        m_condition.wait_for(lock, m_interval, [this] { return m_stopped; });
+
+        lock.unlock();
+
+        try {
+            flush();
+        } catch(const std::exception& e) {
+            COCAINE_LOG_ERROR(m_log, "unable to export spans: %s", e.what());
+        }
+
+        lock.lock();
+    }
+}
+
+void
+span_recorder_t::flush() {
+    std::vector<std::shared_ptr<ring_t>> rings;
+
+    m_rings.apply([&](std::vector<std::shared_ptr<ring_t>>& active) {
+        rings = active;
+
+        // Buffers which are only referenced from here belong to threads which have exited, and
+        // won't be written to anymore.
+        active.erase(std::remove_if(active.begin(), active.end(),
+            [](const std::shared_ptr<ring_t>& ptr) { return ptr.use_count() == 2; }
+        ), active.end());
+    });
+
+    std::vector<event_t> events;
+    size_t dropped = 0;
+
+    for(auto it = rings.begin(); it != rings.end(); ++it) {
+        dropped += (*it)->drain(events);
+    }
+
+    if(dropped) {
+        COCAINE_LOG_WARNING(m_log, "dropped %llu span annotation(s), recording buffers are full",
+            dropped);
+    }
+
+    if(events.empty()) {
+        return;
+    }
+
+    // NOTE: Annotations of the same span are merged if they've been recorded within the same
+    // export interval, the rest is merged by Zipkin itself.
+    std::map<std::pair<uint64_t, uint64_t>, std::vector<const event_t*>> spans;
+
+    for(auto it = events.begin(); it != events.end(); ++it) {
+        spans[std::make_pair(it->trace_id, it->span_id)].push_back(&*it);
+    }
+
+    // NOTE: The file is reopened for every export, so that it can be rotated.
+    std::ofstream stream(m_path, std::ios::app);
+
+    if(!stream) {
+        COCAINE_LOG_ERROR(m_log, "unable to open '%s', dropped %llu span(s)", m_path, spans.size());
+        return;
+    }
+
+    stream << '[';
+
+    for(auto span = spans.begin(); span != spans.end(); ++span) {
+        const auto& annotations = span->second;
+        const auto& first = *annotations.front();
+
+        if(span != spans.begin()) {
+            stream << ',';
+        }
+
+        stream << "{\"traceId\":\"" << hex_t{first.trace_id} << "\",\"id\":\"" << hex_t{first.span_id}
+               << '"';
+
+        if(first.parent_id != trace_t::zero_value) {
+            stream << ",\"parentId\":\"" << hex_t{first.parent_id} << '"';
+        }
+
+        stream << ",\"name\":" << quoted_t{trace_t::name(first.rpc_name)} << ",\"annotations\":[";
+
+        for(auto it = annotations.begin(); it != annotations.end(); ++it) {
+            if(it != annotations.begin()) {
+                stream << ',';
+            }
+
+            stream << "{\"timestamp\":" << (*it)->timestamp
+                   << ",\"value\":\"" << describe((*it)->annotation)
+                   << "\",\"endpoint\":{\"serviceName\":" << quoted_t{trace_t::name((*it)->endpoint)}
+                   << "}}";
+        }
+
+        stream << "]}";
+    }
+
+    stream << "]\n";
+}
+
+span_recorder_t::ring_t&
+span_recorder_t::ring() {
+    static thread_local std::pair<uint64_t, std::shared_ptr<ring_t>> local(0, nullptr);
+
+    if(local.first != m_id) {
+        // NOTE: Threads are only registered once per recorder, normally it's the very first
+        // annotation recorded by an engine thread.
+        local.first  = m_id;
+        local.second = std::make_shared<ring_t>(m_capacity);
+
+        m_rings->push_back(local.second);
+    }
+
+    return *local.second;
+}
@@ -0,0 +1,148 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/rpc/worker_pool.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+#if defined(__linux__)
+    #include <sys/prctl.h>
+#elif defined(__APPLE__)
+    #include <pthread.h>
+#endif
+
+using namespace cocaine::io;
+
+struct worker_pool_t::state_t {
+    explicit
+    state_t(size_t limit_):
+        limit(limit_),
+        stopped(false),
+        active(0),
+        completed(0),
+        rejected(0)
+    { }
+
+    const size_t limit;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+
+    std::deque<task_type> queue;
+    bool stopped;
+
+    size_t active;
+    uint64_t completed;
+    uint64_t rejected;
+};
+
+worker_pool_t::worker_pool_t(const std::string& name, size_t threads, size_t limit):
+    m_state(std::make_shared<state_t>(limit))
+{
+    while(m_threads.size() != threads) {
+        m_threads.emplace_back(&worker_pool_t::run, m_state, name);
+    }
+}
+
+worker_pool_t::~worker_pool_t() {
+    {
+        std::lock_guard<std::mutex> guard(m_state->mutex);
+        m_state->stopped = true;
+    }
+
+    m_state->condition.notify_all();
+
+    for(auto it = m_threads.begin(); it != m_threads.end(); ++it) {
+        if(it->get_id() == std::this_thread::get_id()) {
+            // The thread will exit on its own once the task it's running is complete.
+            it->detach();
+        } else {
+            it->join();
+        }
+    }
+}
+
+bool
+worker_pool_t::post(task_type task) {
+    {
+        std::lock_guard<std::mutex> guard(m_state->mutex);
+
+        if(m_state->stopped || m_state->queue.size() >= m_state->limit) {
+            m_state->rejected++;
+            return false;
+        }
+
+        m_state->queue.push_back(std::move(task));
+    }
+
+    m_state->condition.notify_one();
+
+    return true;
+}
+
+auto
+worker_pool_t::stats() const -> stats_t {
+    std::lock_guard<std::mutex> guard(m_state->mutex);
+
+    return stats_t{m_state->queue.size(), m_state->active, m_state->completed, m_state->rejected};
+}
+
+void
+worker_pool_t::run(const std::shared_ptr<state_t>& state, const std::string& name) {
+#if defined(__linux__)
+    ::prctl(PR_SET_NAME, name.substr(0, 15).c_str());
+#elif defined(__APPLE__)
+    pthread_setname_np(name.c_str());
+#endif
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+
+    while(true) {
+        state->condition.wait(lock, [&] { return state->stopped || !state->queue.empty(); });
+
+        // NOTE: The queue is drained before stopping, so that every accepted task gets to reply.
+        if(state->queue.empty()) {
+            return;
+        }
+
+        task_type task = std::move(state->queue.front());
+        state->queue.pop_front();
+
+        state->active++;
+
+        lock.unlock();
+
+        try {
+            task();
+        } catch(...) {
+            // NOTE: Tasks are supposed to report their errors themselves.
+        }
+
+        // Release whatever the task has captured outside of the lock.
+        task = nullptr;
+
+        lock.lock();
+
+        state->active--;
+        state->completed++;
+    }
+}
@@ -0,0 +1,205 @@
+#include "cocaine/common.hpp"
+
+#include "cocaine/context.hpp"
+
+#include "cocaine/idl/streaming.hpp"
+
+#include "cocaine/rpc/asio/decoder.hpp"
+#include "cocaine/rpc/asio/encoder.hpp"
+#include "cocaine/rpc/asio/transport.hpp"
+#include "cocaine/rpc/session.hpp"
+#include "cocaine/rpc/upstream.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <random>
+
+#include <celero/Celero.h>
+
+#include <asio/io_service.hpp>
+#include <asio/local/connect_pair.hpp>
+#include <asio/local/stream_protocol.hpp>
+
+#include <boost/thread/thread.hpp>
+
+// Benchmarks which have to prove they don't allocate. They are built separately from the others,
+// because the global operator new is replaced to count the heap allocations, which would skew all
+// the other benchmarks as well.
+
+static std::atomic<size_t> allocations(0);
+
+void*
+operator new(size_t size) {
+    allocations++;
+
+    if(void* ptr = std::malloc(size)) {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+void
+operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+struct decoder_fixture_t:
+    public celero::TestFixture
+{
+    typedef cocaine::io::streaming<boost::mpl::list<std::string>::type>::chunk event_type;
+
+    std::string frame;
+
+    cocaine::io::decoder_t decoder;
+    cocaine::io::decoder_t::message_type message;
+
+    size_t decoded;
+    size_t allocated;
+
+public:
+    virtual
+    void
+    setUp(int64_t) {
+        cocaine::io::encoder_t encoder;
+
+        std::string data;
+
+        std::random_device rd;
+        std::generate_n(std::back_inserter(data), 1024, std::ref(rd));
+
+        const auto encoded = encoder.encode(cocaine::io::encoded<event_type>(1, data));
+
+        std::vector<asio::const_buffer> buffers;
+
+        encoded.buffers(std::back_inserter(buffers));
+
+        for(auto it = buffers.begin(); it != buffers.end(); ++it) {
+            frame.append(asio::buffer_cast<const char*>(*it), asio::buffer_size(*it));
+        }
+
+        // Warm the decoder up, so that only the steady state allocations are counted.
+        run();
+
+        decoded = 0;
+        allocated = allocations;
+    }
+
+    virtual
+    void
+    tearDown() {
+        std::cout << "DecoderBenchmark: "
+                  << static_cast<double>(allocations - allocated) / decoded
+                  << " allocation(s) per message" << std::endl;
+
+        frame.clear();
+    }
+
+    void
+    run() {
+        std::error_code ec;
+
+        decoder.decode(frame.data(), frame.size(), message, ec);
+        message.clear();
+
+        decoded++;
+    }
+};
+
+BASELINE_F (DecoderBenchmark, Decode1K, decoder_fixture_t, 10, 100000) {
+    run();
+}
+
+struct session_fixture_t:
+    public celero::TestFixture
+{
+    typedef asio::local::stream_protocol protocol_type;
+    typedef cocaine::io::streaming<boost::mpl::list<uint64_t>::type>::chunk event_type;
+
+    std::unique_ptr<cocaine::context_t> context;
+    std::unique_ptr<asio::io_service> reactor;
+    std::unique_ptr<protocol_type::socket> peer;
+    std::unique_ptr<boost::thread> chamber;
+
+    std::shared_ptr<cocaine::session<protocol_type>> session;
+    std::unique_ptr<cocaine::io::basic_upstream_t> upstream;
+
+    std::array<char, 65536> sink;
+
+    size_t sent;
+    size_t allocated;
+
+public:
+    virtual
+    void
+    setUp(int64_t) {
+        context.reset(new cocaine::context_t(cocaine::config_t("cocaine-benchmark.conf"), "core"));
+        reactor.reset(new asio::io_service());
+
+        auto socket = std::make_unique<protocol_type::socket>(*reactor);
+
+        peer.reset(new protocol_type::socket(*reactor));
+
+        asio::local::connect_pair(*socket, *peer);
+
+        session = std::make_shared<cocaine::session<protocol_type>>(
+            context->log("benchmark"),
+            std::make_unique<cocaine::io::transport<protocol_type>>(std::move(socket)),
+            nullptr
+        );
+
+        upstream.reset(new cocaine::io::basic_upstream_t(session, 1, boost::none));
+
+        discard();
+
+        chamber.reset(new boost::thread([this]{ reactor->run(); }));
+
+        // Warm the session up, so that only the steady state allocations are counted.
+        for(int i = 0; i < 1024; ++i) {
+            run();
+        }
+
+        sent = 0;
+        allocated = allocations;
+    }
+
+    virtual
+    void
+    tearDown() {
+        std::cout << "SessionBenchmark: "
+                  << static_cast<double>(allocations - allocated) / sent
+                  << " allocation(s) per message" << std::endl;
+
+        session->detach(std::error_code());
+        reactor->stop();
+        chamber->join();
+
+        upstream.reset();
+        session.reset();
+        peer.reset();
+    }
+
+    void
+    run() {
+        upstream->send<event_type>(static_cast<uint64_t>(sent++));
+    }
+
+private:
+    void
+    discard() {
+        peer->async_read_some(asio::buffer(sink), [this](const std::error_code& ec, size_t) {
+            if(!ec) discard();
+        });
+    }
+};
+
+BASELINE_F (SessionBenchmark, Send, session_fixture_t, 10, 100000) {
+    run();
+}
+
+CELERO_MAIN
@@ -5,22 +5,42 @@
 #include "cocaine/api/service.hpp"
 
 #include "cocaine/context.hpp"
+#include "cocaine/detail/admission.hpp"
+#include "cocaine/detail/balancer.hpp"
 
 #include "cocaine/detail/actor.hpp"
 #include "cocaine/detail/chamber.hpp"
 #include "cocaine/detail/engine.hpp"
 
+#include "cocaine/hpack/header.h"
+#include "cocaine/hpack/header.hpp"
+#include "cocaine/hpack/huffman.hpp"
+
 #include "cocaine/logging.hpp"
 
+#include "cocaine/idl/streaming.hpp"
+
+#include "cocaine/rpc/asio/decoder.hpp"
+#include "cocaine/rpc/asio/encoder.hpp"
+#include "cocaine/rpc/asio/transport.hpp"
 #include "cocaine/rpc/dispatch.hpp"
+#include "cocaine/rpc/upstream.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <deque>
+#include <iostream>
 #include <random>
+#include <thread>
 
 #include <celero/Celero.h>
 
 #include <asio/connect.hpp>
 #include <asio/io_service.hpp>
 #include <asio/ip/tcp.hpp>
+#include <asio/local/connect_pair.hpp>
+#include <asio/local/stream_protocol.hpp>
 
 namespace cocaine { namespace io {
 
@@ -215,4 +235,719 @@ BENCHMARK_F(ClientIoBenchmark65K, EchoSlot, test_fixture_t, 10, 100000) {
     service.invoke<cocaine::io::test::echo_slot>(nullptr, globals().data65K);
 }
 
+// Round trip latency of echo invocations handled by an engine, either left to the scheduler or
+// pinned to a core, along with all of its buffers.
+struct affinity_fixture_t:
+    public celero::TestFixture
+{
+    typedef asio::local::stream_protocol protocol_type;
+    typedef std::chrono::steady_clock clock_type;
+
+    std::unique_ptr<cocaine::context_t> context;
+    std::unique_ptr<cocaine::execution_unit_t> engine;
+
+    asio::io_service reactor;
+
+    std::unique_ptr<cocaine::io::transport<protocol_type>> transport;
+    cocaine::io::decoder_t::message_type message;
+
+    uint64_t channel;
+
+    std::vector<clock_type::duration> latencies;
+
+    bool pinned;
+
+public:
+    affinity_fixture_t():
+        pinned(false)
+    { }
+
+    virtual
+    void
+    setUp(int64_t) {
+        cocaine::config_t config("cocaine-benchmark.conf");
+
+        if(pinned) {
+            config.affinity.engines.push_back(cocaine::config_t::placement_t{true, {}, {}});
+        }
+
+        context.reset(new cocaine::context_t(config, "core"));
+        engine = std::make_unique<cocaine::execution_unit_t>(*context);
+
+        auto socket = std::make_unique<protocol_type::socket>(reactor);
+        auto peer   = std::make_unique<protocol_type::socket>(reactor);
+
+        asio::local::connect_pair(*socket, *peer);
+
+        engine->attach(std::move(socket), std::make_shared<cocaine::test_service_t>());
+        transport = std::make_unique<cocaine::io::transport<protocol_type>>(std::move(peer));
+
+        channel = 0;
+        latencies.clear();
+    }
+
+    virtual
+    void
+    tearDown() {
+        std::sort(latencies.begin(), latencies.end());
+
+        std::cout << "AffinityBenchmark: " << (pinned ? "pinned" : "unpinned") << " round trip p50 "
+                  << std::chrono::duration_cast<std::chrono::microseconds>(
+                         latencies[latencies.size() / 2]).count()
+                  << " us, p99 "
+                  << std::chrono::duration_cast<std::chrono::microseconds>(
+                         latencies[latencies.size() * 99 / 100]).count()
+                  << " us" << std::endl;
+
+        transport->socket->close();
+        reactor.run();
+
+        transport.reset();
+        engine.reset();
+        context.reset();
+    }
+
+    void
+    run() {
+        const auto started = clock_type::now();
+
+        bool replied = false;
+
+        transport->writer->write(
+            cocaine::io::encoded<cocaine::io::test::echo_slot>(++channel, globals().data1K),
+            nullptr
+        );
+
+        transport->reader->read(message, [&](const std::error_code&) { replied = true; });
+
+        while(!replied) {
+            reactor.run_one();
+        }
+
+        latencies.push_back(clock_type::now() - started);
+    }
+};
+
+struct pinned_affinity_fixture_t:
+    public affinity_fixture_t
+{
+    pinned_affinity_fixture_t() {
+        pinned = true;
+    }
+};
+
+BASELINE_F (AffinityBenchmark, Unpinned, affinity_fixture_t, 10, 10000) {
+    run();
+}
+
+BENCHMARK_F(AffinityBenchmark, Pinned, pinned_affinity_fixture_t, 10, 10000) {
+    run();
+}
+
+struct encoder_fixture_t:
+    public celero::TestFixture
+{
+    cocaine::io::encoder_t encoder;
+
+    const std::string payload;
+
+    size_t encoded;
+    size_t bytes;
+
+public:
+    encoder_fixture_t():
+        payload("ping")
+    { }
+
+    virtual
+    void
+    setUp(int64_t) {
+        encoded = 0;
+        bytes = 0;
+    }
+
+    virtual
+    void
+    tearDown() {
+        std::cout << "EncoderBenchmark: "
+                  << static_cast<double>(bytes) / encoded
+                  << " byte(s) per message" << std::endl;
+    }
+
+    void
+    run() {
+        auto message = encoder.encode(
+            cocaine::io::encoded<cocaine::io::test::mute_slot>(1, payload)
+        );
+
+        bytes += message.size();
+        encoded++;
+
+        encoder.recycle(std::move(message));
+    }
+};
+
+struct traced_encoder_fixture_t:
+    public encoder_fixture_t
+{
+    virtual
+    void
+    setUp(int64_t size) {
+        encoder_fixture_t::setUp(size);
+        cocaine::trace_t::current() = cocaine::trace_t::generate("benchmark");
+    }
+
+    virtual
+    void
+    tearDown() {
+        cocaine::trace_t::current() = cocaine::trace_t();
+        encoder_fixture_t::tearDown();
+    }
+};
+
+BASELINE_F (EncoderBenchmark, Untraced, encoder_fixture_t, 10, 1000000) {
+    run();
+}
+
+BENCHMARK_F(EncoderBenchmark, Traced, traced_encoder_fixture_t, 10, 1000000) {
+    run();
+}
+
+struct huffman_fixture_t:
+    public celero::TestFixture
+{
+    std::vector<std::string> values;
+    std::vector<std::string> coded;
+
+    std::vector<char> buffer;
+
+    size_t plain_bytes;
+    size_t coded_bytes;
+
+public:
+    virtual
+    void
+    setUp(int64_t) {
+        // Typical header values.
+        values = {
+            "application/json",
+            "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko)",
+            "https://www.example.com/api/v1/storage/collections?limit=100",
+            "gzip, deflate",
+            "max-age=0, no-cache, no-store",
+            "en-US,en;q=0.8"
+        };
+
+        coded.clear();
+        buffer.resize(1024);
+
+        plain_bytes = 0;
+        coded_bytes = 0;
+
+        for(auto it = values.begin(); it != values.end(); ++it) {
+            coded.emplace_back(cocaine::hpack::huffman::encode(it->data(), it->size(), buffer.data()),
+                '\0');
+            cocaine::hpack::huffman::encode(it->data(), it->size(), &coded.back()[0]);
+
+            plain_bytes += it->size();
+            coded_bytes += coded.back().size();
+        }
+    }
+
+    virtual
+    void
+    tearDown() {
+        std::cout << "HuffmanBenchmark: " << coded_bytes << " coded byte(s) for " << plain_bytes
+                  << " plain byte(s), " << 100 - coded_bytes * 100 / plain_bytes << "% saved"
+                  << std::endl;
+    }
+};
+
+BASELINE_F (HuffmanBenchmark, Copy, huffman_fixture_t, 10, 100000) {
+    for(auto it = values.begin(); it != values.end(); ++it) {
+        std::memcpy(buffer.data(), it->data(), it->size());
+    }
+
+    celero::DoNotOptimizeAway(buffer[0]);
+}
+
+BENCHMARK_F(HuffmanBenchmark, Encode, huffman_fixture_t, 10, 100000) {
+    for(auto it = values.begin(); it != values.end(); ++it) {
+        cocaine::hpack::huffman::encode(it->data(), it->size(), buffer.data());
+    }
+
+    celero::DoNotOptimizeAway(buffer[0]);
+}
+
+BENCHMARK_F(HuffmanBenchmark, Decode, huffman_fixture_t, 10, 100000) {
+    size_t decoded;
+
+    for(auto it = coded.begin(); it != coded.end(); ++it) {
+        cocaine::hpack::huffman::decode(it->data(), it->size(), buffer.data(), decoded);
+    }
+
+    celero::DoNotOptimizeAway(buffer[0]);
+}
+
+// Lookups in a full HPACK header table, a half of them are found in its dynamic part and the other
+// half in its static part.
+
+struct header_table_fixture_t:
+    public celero::TestFixture
+{
+    std::unique_ptr<cocaine::hpack::header_table_t> table;
+
+    std::vector<std::string> values;
+    std::vector<cocaine::hpack::header_t> lookups;
+
+public:
+    virtual
+    void
+    setUp(int64_t) {
+        using namespace cocaine::hpack;
+
+        table = std::make_unique<header_table_t>();
+
+        values.clear();
+        lookups.clear();
+
+        for(size_t i = 0; i < header_table_t::max_header_capacity; ++i) {
+            values.push_back(std::to_string(i));
+        }
+
+        for(auto it = values.begin(); it != values.end(); ++it) {
+            header_t header(ch_header{{"test_name", 9}, {it->data(), it->size()}});
+
+            table->push(header);
+            lookups.push_back(header);
+            lookups.push_back(headers::make_header<headers::span_id<>>());
+        }
+    }
+};
+
+BASELINE_F (HeaderTableBenchmark, FindByName, header_table_fixture_t, 10, 100000) {
+    size_t found = 0;
+
+    for(auto it = lookups.begin(); it != lookups.end(); ++it) {
+        found += table->find_by_name(*it);
+    }
+
+    celero::DoNotOptimizeAway(found);
+}
+
+BENCHMARK_F(HeaderTableBenchmark, FindByFullMatch, header_table_fixture_t, 10, 100000) {
+    size_t found = 0;
+
+    for(auto it = lookups.begin(); it != lookups.end(); ++it) {
+        found += table->find_by_full_match(*it);
+    }
+
+    celero::DoNotOptimizeAway(found);
+}
+
+// Latency of small replies sent over a connection which is also used to stream large chunks to a slow
+// client, from the moment they are written to the moment they are handed over to the socket. The
+// baseline sends them to the same channel as the chunks, so they have to wait for the whole backlog.
+struct mixed_traffic_fixture_t:
+    public celero::TestFixture
+{
+    typedef asio::local::stream_protocol protocol_type;
+    typedef cocaine::io::streaming<boost::mpl::list<std::string>::type>::chunk event_type;
+    typedef std::chrono::steady_clock clock_type;
+
+    // Amount of data the streaming producer keeps queued.
+    static const size_t kBacklog = 4194304;
+
+    std::unique_ptr<asio::io_service> reactor;
+    std::unique_ptr<cocaine::io::transport<protocol_type>> transport;
+    std::unique_ptr<protocol_type::socket> peer;
+
+    std::array<char, 65536> sink;
+
+    std::string chunk;
+    std::string reply;
+
+    // Channel the replies are sent to.
+    uint64_t channel;
+
+    std::vector<clock_type::duration> latencies;
+
+public:
+    mixed_traffic_fixture_t():
+        chunk(262144, 'x'),
+        reply(64, 'x'),
+        channel(1)
+    { }
+
+    virtual
+    void
+    setUp(int64_t) {
+        reactor.reset(new asio::io_service());
+
+        auto socket = std::make_unique<protocol_type::socket>(*reactor);
+
+        peer.reset(new protocol_type::socket(*reactor));
+
+        asio::local::connect_pair(*socket, *peer);
+
+        transport = std::make_unique<cocaine::io::transport<protocol_type>>(std::move(socket));
+
+        // The client reads a single buffer per step, so that the backlog builds up.
+        peer->non_blocking(true);
+
+        latencies.clear();
+    }
+
+    virtual
+    void
+    tearDown() {
+        std::sort(latencies.begin(), latencies.end());
+
+        std::cout << "MixedTrafficBenchmark: reply latency p50 "
+                  << std::chrono::duration_cast<std::chrono::microseconds>(
+                         latencies[latencies.size() / 2]).count()
+                  << " us, p99 "
+                  << std::chrono::duration_cast<std::chrono::microseconds>(
+                         latencies[latencies.size() * 99 / 100]).count()
+                  << " us" << std::endl;
+
+        // Abort the writes still in progress, so that nothing outlives the reactor.
+        transport->socket->close();
+        reactor->run();
+
+        transport.reset();
+        peer.reset();
+        reactor.reset();
+    }
+
+    void
+    run() {
+        const auto& writer = transport->writer;
+
+        writer->write(cocaine::io::encoded<event_type>(1, chunk), nullptr);
+
+        const auto started = clock_type::now();
+
+        writer->write(cocaine::io::encoded<event_type>(channel, reply),
+            [this, started](const std::error_code&) {
+                latencies.push_back(clock_type::now() - started);
+            }
+        );
+
+        do {
+            std::error_code ec;
+
+            peer->read_some(asio::buffer(sink), ec);
+            reactor->poll();
+        } while(writer->pressure() > kBacklog);
+    }
+};
+
+struct lanes_mixed_traffic_fixture_t:
+    public mixed_traffic_fixture_t
+{
+    lanes_mixed_traffic_fixture_t() {
+        channel = 2;
+    }
+};
+
+BASELINE_F (MixedTrafficBenchmark, SameChannel, mixed_traffic_fixture_t, 10, 10000) {
+    run();
+}
+
+BENCHMARK_F(MixedTrafficBenchmark, OtherChannel, lanes_mixed_traffic_fixture_t, 10, 10000) {
+    run();
+}
+
+// A burst of connections spread over a pool of engines, reported as the ratio of the busiest engine's
+// session count to the average one. Utilization based balancing can't react to the burst at all.
+struct balancer_fixture_t:
+    public celero::TestFixture
+{
+    typedef asio::local::stream_protocol protocol_type;
+
+    static const size_t kPoolSize = 4;
+
+    std::unique_ptr<cocaine::context_t> context;
+    std::unique_ptr<cocaine::balancer_t> balancer;
+
+    cocaine::balancer_t::pool_type pool;
+
+    asio::io_service reactor;
+
+    // Client ends of the connections, so that the sessions stay alive.
+    std::vector<std::unique_ptr<protocol_type::socket>> peers;
+
+    std::string strategy;
+
+public:
+    balancer_fixture_t():
+        strategy("load")
+    { }
+
+    virtual
+    void
+    setUp(int64_t) {
+        context.reset(new cocaine::context_t(cocaine::config_t("cocaine-benchmark.conf"), "core"));
+        balancer = cocaine::make_balancer(strategy);
+
+        while(pool.size() != kPoolSize) {
+            pool.emplace_back(std::make_unique<cocaine::execution_unit_t>(*context));
+        }
+    }
+
+    virtual
+    void
+    tearDown() {
+        size_t total = 0;
+        size_t busiest = 0;
+
+        for(auto it = pool.begin(); it != pool.end(); ++it) {
+            total  += (*it)->load().sessions;
+            busiest = std::max<size_t>(busiest, (*it)->load().sessions);
+        }
+
+        std::cout << "BalancerBenchmark: '" << strategy << "' skew "
+                  << static_cast<double>(busiest) * kPoolSize / total << std::endl;
+
+        // NOTE: Destroying the engines detaches their sessions.
+        pool.clear();
+        peers.clear();
+        context.reset();
+    }
+
+    void
+    run() {
+        auto socket = std::make_unique<protocol_type::socket>(reactor);
+        auto peer   = std::make_unique<protocol_type::socket>(reactor);
+
+        asio::local::connect_pair(*socket, *peer);
+
+        balancer->select(pool).attach(std::move(socket), nullptr);
+        peers.push_back(std::move(peer));
+    }
+};
+
+struct sessions_balancer_fixture_t:
+    public balancer_fixture_t
+{
+    sessions_balancer_fixture_t() {
+        strategy = "sessions";
+    }
+};
+
+struct two_choices_balancer_fixture_t:
+    public balancer_fixture_t
+{
+    two_choices_balancer_fixture_t() {
+        strategy = "two-choices";
+    }
+};
+
+BASELINE_F (BalancerBenchmark, Load, balancer_fixture_t, 10, 200) {
+    run();
+}
+
+BENCHMARK_F(BalancerBenchmark, Sessions, sessions_balancer_fixture_t, 10, 200) {
+    run();
+}
+
+BENCHMARK_F(BalancerBenchmark, TwoChoices, two_choices_balancer_fixture_t, 10, 200) {
+    run();
+}
+
+// Connections accepted per second, from connect() until the session is attached to an engine. The
+// baseline accepts on the service thread and hands connections over to the engines, the alternative
+// lets every engine accept on its own via SO_REUSEPORT.
+struct accept_fixture_t:
+    public celero::TestFixture
+{
+    std::unique_ptr<cocaine::context_t> context;
+    asio::io_service reactor;
+
+    std::vector<asio::ip::tcp::endpoint> endpoints;
+
+    // Client ends of the connections, so that the sessions stay alive.
+    std::vector<std::unique_ptr<asio::ip::tcp::socket>> peers;
+
+    bool reuseport;
+
+public:
+    accept_fixture_t():
+        reuseport(false)
+    { }
+
+    virtual
+    void
+    setUp(int64_t) {
+        cocaine::config_t config("cocaine-benchmark.conf");
+
+        config.network.reuseport = reuseport;
+
+        context.reset(new cocaine::context_t(config, "core"));
+
+        context->insert("benchmark", std::make_unique<cocaine::actor_t>(
+           *context,
+            std::make_shared<asio::io_service>(),
+            std::make_unique<cocaine::test_service_t>()
+        ));
+
+        endpoints = context->locate("benchmark").get().endpoints();
+    }
+
+    virtual
+    void
+    tearDown() {
+        context->remove("benchmark");
+        peers.clear();
+        context.reset();
+    }
+
+    void
+    run() {
+        auto socket = std::make_unique<asio::ip::tcp::socket>(reactor);
+
+        asio::connect(*socket, endpoints.begin(), endpoints.end());
+        peers.push_back(std::move(socket));
+
+        // Wait for the connection to be attached to some engine.
+        while(sessions() != peers.size()) {
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    size_t
+    sessions() const {
+        const auto& engines = context->engines();
+
+        size_t total = 0;
+
+        for(auto it = engines.begin(); it != engines.end(); ++it) {
+            total += (*it)->load().sessions;
+        }
+
+        return total;
+    }
+};
+
+struct reuseport_accept_fixture_t:
+    public accept_fixture_t
+{
+    reuseport_accept_fixture_t() {
+        reuseport = true;
+    }
+};
+
+BASELINE_F (AcceptBenchmark, Handover, accept_fixture_t, 10, 200) {
+    run();
+}
+
+BENCHMARK_F(AcceptBenchmark, ReusePort, reuseport_accept_fixture_t, 10, 200) {
+    run();
+}
+
+// An engine under 2x overload, simulated in virtual time: invocations arrive twice as fast as they
+// can be handled, and the queueing delay is sampled by a periodic probe queued along with them, the
+// same way the engine does it.
+struct admission_fixture_t:
+    public celero::TestFixture
+{
+    typedef cocaine::io::admission_t::clock_type clock_type;
+
+    struct item_t {
+        clock_type::time_point queued;
+        bool probe;
+    };
+
+    std::unique_ptr<cocaine::io::admission_t> admission;
+
+    std::deque<item_t> queue;
+    std::vector<clock_type::duration> latencies;
+
+    clock_type::time_point arrived;
+    clock_type::time_point handled;
+    clock_type::time_point probed;
+
+    size_t shed;
+
+public:
+    virtual
+    void
+    setUp(int64_t) {
+        queue.clear();
+        latencies.clear();
+
+        arrived = handled = probed = clock_type::now();
+
+        shed = 0;
+    }
+
+    virtual
+    void
+    tearDown() {
+        std::sort(latencies.begin(), latencies.end());
+
+        std::cout << "AdmissionBenchmark: p99 latency "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(
+                         latencies[latencies.size() * 99 / 100]).count()
+                  << " ms, " << shed * 100 / (shed + latencies.size()) << "% shed" << std::endl;
+    }
+
+    void
+    run() {
+        const auto handling  = std::chrono::microseconds(100);
+        const auto rejection = std::chrono::microseconds(2);
+
+        arrived += std::chrono::microseconds(50);
+
+        while(probed <= arrived) {
+            queue.push_back(item_t{probed, true});
+            probed += std::chrono::milliseconds(1);
+        }
+
+        queue.push_back(item_t{arrived, false});
+
+        while(!queue.empty() && handled <= arrived) {
+            const auto item = queue.front();
+
+            queue.pop_front();
+            handled = std::max(handled, item.queued);
+
+            if(item.probe) {
+                if(admission) admission->sample(handled - item.queued, handled);
+            } else if(admission && !admission->admit()) {
+                handled += rejection;
+                shed++;
+            } else {
+                handled += handling;
+                latencies.push_back(handled - item.queued);
+            }
+        }
+    }
+};
+
+struct codel_admission_fixture_t:
+    public admission_fixture_t
+{
+    virtual
+    void
+    setUp(int64_t size) {
+        admission_fixture_t::setUp(size);
+
+        admission.reset(new cocaine::io::admission_t(
+            std::chrono::milliseconds(5),
+            std::chrono::milliseconds(100)
+        ));
+    }
+};
+
+BASELINE_F (AdmissionBenchmark, Unlimited, admission_fixture_t, 10, 1000000) {
+    run();
+}
+
+BENCHMARK_F(AdmissionBenchmark, CoDel, codel_admission_fixture_t, 10, 1000000) {
+    run();
+}
+
 CELERO_MAIN
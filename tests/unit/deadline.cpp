@@ -0,0 +1,200 @@
+/*
+    Copyright (c) 2011-2015 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "session_fixture.hpp"
+
+#include <cocaine/rpc/deadline.hpp>
+#include <cocaine/rpc/upstream.hpp>
+
+#include <msgpack.hpp>
+
+using namespace cocaine;
+using namespace cocaine::io;
+
+TEST(deadline_t, extension_index_is_negotiated) {
+    encoder_t encoder;
+
+    deadline_t::scope_t scope(deadline_t::after(std::chrono::seconds(10)));
+
+    // The first message advertises the extension table, and the peer hasn't advertised it yet, so the
+    // deadline is sent with its name, which every peer understands.
+    const auto first = frame(encoder, encoded<session_test::call>(1, std::string("payload")));
+
+    msgpack::unpacked result;
+    msgpack::unpack(&result, first.data(), first.size());
+
+    msgpack::object headers = result.get().via.array.ptr[3];
+
+    ASSERT_EQ(2, headers.via.array.size);
+    ASSERT_EQ("extension_table", headers.via.array.ptr[0].via.array.ptr[1].as<std::string>());
+    ASSERT_EQ("deadline", headers.via.array.ptr[1].via.array.ptr[1].as<std::string>());
+
+    // Once the peer has advertised its support, the extension table index is used instead.
+    encoder.accept_extensions();
+
+    const auto second = frame(encoder, encoded<session_test::call>(3, std::string("payload")));
+
+    msgpack::unpack(&result, second.data(), second.size());
+
+    headers = result.get().via.array.ptr[3];
+
+    ASSERT_EQ(1, headers.via.array.size);
+    ASSERT_EQ(hpack::header_extension_table_t::idx<hpack::headers::deadline<>>(),
+        headers.via.array.ptr[0].via.array.ptr[1].as<uint64_t>());
+
+    // Both are decoded as the same header.
+    decoder_t decoder;
+    decoder_t::message_type message;
+    std::error_code ec;
+
+    decoder.decode(first.data(), first.size(), message, ec);
+
+    ASSERT_FALSE(ec);
+    ASSERT_TRUE(message.meta<hpack::headers::deadline<>>());
+
+    message.clear();
+    decoder.decode(second.data(), second.size(), message, ec);
+
+    ASSERT_FALSE(ec);
+    ASSERT_TRUE(message.meta<hpack::headers::deadline<>>());
+}
+
+TEST(deadline_t, expired_invocation_is_rejected) {
+    session_fixture_t fixture;
+
+    {
+        deadline_t::scope_t scope(deadline_t::after(std::chrono::microseconds(0)));
+        fixture.send(encoded<session_test::call>(1, std::string("payload")));
+    }
+
+    fixture.session->pull();
+    fixture.receive();
+
+    ASSERT_EQ(1, fixture.message.span());
+    ASSERT_EQ(event_traits<session_test_reply::error>::id, fixture.message.type());
+
+    ASSERT_EQ(make_error_code(error::deadline_expired), fixture.error());
+    ASSERT_EQ(0, fixture.calls);
+}
+
+TEST(deadline_t, pipelined_messages_of_rejected_invocation_are_dropped) {
+    session_fixture_t fixture;
+
+    {
+        deadline_t::scope_t scope(deadline_t::after(std::chrono::microseconds(0)));
+        fixture.send(encoded<session_test::call>(1, std::string("expired")));
+    }
+
+    // The client has pipelined another message into the channel before getting the error.
+    fixture.send(encoded<session_test::call>(1, std::string("pipelined")));
+    fixture.send(encoded<session_test::call>(2, std::string("payload")));
+
+    fixture.session->pull();
+    fixture.receive();
+
+    ASSERT_EQ(1, fixture.message.span());
+    ASSERT_EQ(event_traits<session_test_reply::error>::id, fixture.message.type());
+
+    fixture.receive();
+
+    ASSERT_EQ(2, fixture.message.span());
+    ASSERT_EQ(event_traits<session_test_reply::value>::id, fixture.message.type());
+
+    ASSERT_FALSE(fixture.session->is_detached());
+    ASSERT_EQ(1, fixture.calls);
+}
+
+TEST(deadline_t, pipelined_messages_of_sustained_rejections_are_dropped) {
+    session_fixture_t fixture;
+
+    const uint64_t rejections = 64;
+
+    {
+        deadline_t::scope_t scope(deadline_t::after(std::chrono::microseconds(0)));
+
+        for(uint64_t channel_id = 1; channel_id <= rejections; ++channel_id) {
+            fixture.send(encoded<session_test::call>(channel_id, std::string("expired")));
+        }
+    }
+
+    for(uint64_t channel_id = 1; channel_id <= rejections; ++channel_id) {
+        fixture.send(encoded<session_test::call>(channel_id, std::string("pipelined")));
+    }
+
+    fixture.send(encoded<session_test::call>(rejections + 1, std::string("payload")));
+
+    fixture.session->pull();
+
+    for(uint64_t channel_id = 1; channel_id <= rejections; ++channel_id) {
+        fixture.receive();
+
+        ASSERT_EQ(channel_id, fixture.message.span());
+        ASSERT_EQ(event_traits<session_test_reply::error>::id, fixture.message.type());
+    }
+
+    fixture.receive();
+
+    ASSERT_EQ(rejections + 1, fixture.message.span());
+    ASSERT_EQ(event_traits<session_test_reply::value>::id, fixture.message.type());
+
+    ASSERT_FALSE(fixture.session->is_detached());
+    ASSERT_EQ(1, fixture.calls);
+}
+
+TEST(deadline_t, expired_invocation_without_error_reporting_is_handled) {
+    session_fixture_t fixture;
+
+    // The slot has no way to report the rejection, so the client would never know about it.
+    {
+        deadline_t::scope_t scope(deadline_t::after(std::chrono::microseconds(0)));
+        fixture.send(encoded<session_test::notify>(1, std::string("expired")));
+    }
+
+    fixture.session->pull();
+    fixture.handle(1);
+
+    ASSERT_FALSE(fixture.session->is_detached());
+}
+
+TEST(deadline_t, scope_propagates_into_fork) {
+    session_fixture_t fixture;
+
+    upstream_ptr_t upstream;
+
+    {
+        deadline_t::scope_t scope(deadline_t::after(std::chrono::seconds(10)));
+        upstream = fixture.session->fork(fixture.service);
+    }
+
+    ASSERT_TRUE(deadline_t::current().empty());
+    ASSERT_FALSE(upstream->deadline.empty());
+    ASSERT_GT(upstream->deadline.remaining(), std::chrono::seconds(9));
+
+    // The forked channel's messages carry the deadline, even though they are sent out of its scope.
+    upstream->send<session_test::call>(std::string("payload"));
+
+    fixture.receive();
+
+    const auto header = fixture.message.meta<hpack::headers::deadline<>>();
+
+    ASSERT_TRUE(header);
+    ASSERT_GT(header->get_value().convert<uint64_t>(), 9000000);
+    ASSERT_LE(header->get_value().convert<uint64_t>(), 10000000);
+}
@@ -0,0 +1,160 @@
+/*
+    Copyright (c) 2011-2015 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cocaine/idl/primitive.hpp>
+
+#include <cocaine/rpc/asio/encoder.hpp>
+
+#include <cocaine/trace/trace.hpp>
+
+#include <msgpack.hpp>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using namespace cocaine;
+using namespace cocaine::hpack;
+
+namespace {
+
+typedef io::primitive<boost::mpl::list<std::string>::type> reply_type;
+
+// Collects the buffer sequence of the encoded data into a contiguous string.
+std::string
+flatten(const std::vector<asio::const_buffer>& buffers) {
+    std::string result;
+
+    for(auto it = buffers.begin(); it != buffers.end(); ++it) {
+        result.append(asio::buffer_cast<const char*>(*it), asio::buffer_size(*it));
+    }
+
+    return result;
+}
+
+} // namespace
+
+TEST(encoded_buffers_t, large_blob_is_referenced) {
+    const std::string value(io::aux::encoded_buffers_t::kReferenceThreshold, 'x');
+
+    io::aux::encoded_buffers_t buffer;
+    msgpack::packer<io::aux::encoded_buffers_t> packer(buffer);
+
+    packer.pack_raw(value.size());
+    packer.pack_raw_body(value.data(), value.size());
+
+    std::vector<asio::const_buffer> buffers;
+    buffer.buffers(std::back_inserter(buffers));
+
+    ASSERT_EQ(2, buffers.size());
+    ASSERT_EQ(value.data(), asio::buffer_cast<const char*>(buffers[1]));
+}
+
+TEST(encoded_buffers_t, huffman_coded_value_is_copied) {
+    // Large enough for the coded value to be referenced, if it was written as is.
+    std::string value;
+
+    while(value.size() < 4 * io::aux::encoded_buffers_t::kReferenceThreshold) {
+        value.append("www.example.com");
+    }
+
+    io::aux::encoded_buffers_t buffer;
+    io::aux::copied_buffers_t copied(buffer);
+    msgpack::packer<io::aux::copied_buffers_t> packer(copied);
+
+    msgpack_traits::pack_literal<headers::trace_context<>>(packer,
+        header::create_data(value.data(), value.size()), true);
+
+    std::vector<asio::const_buffer> buffers;
+    buffer.buffers(std::back_inserter(buffers));
+
+    // The coded value is gone once packed, so nothing is referenced.
+    ASSERT_EQ(1, buffers.size());
+
+    const std::string encoded = flatten(buffers);
+
+    msgpack::unpacked result;
+    msgpack::unpack(&result, encoded.data(), encoded.size());
+
+    // Huffman coded value flag.
+    ASSERT_EQ(4, result.get().via.array.size);
+    ASSERT_LT(result.get().via.array.ptr[2].via.raw.size, value.size());
+
+    header_table_t table;
+    std::vector<char> storage;
+
+    const header_t header = msgpack_traits::unpack(result.get(), table, [&](size_t size) -> char* {
+        storage.resize(size);
+        return storage.data();
+    });
+
+    ASSERT_EQ(value, std::string(header.get_value().blob, header.get_value().size));
+}
+
+TEST(encoder_t, trace_context_is_negotiated) {
+    io::encoder_t encoder;
+
+    trace_t::restore_scope_t scope(trace_t(1, 2, 3, "test"));
+
+    // The peer hasn't advertised the support for the extension table yet, so the ids are sent as
+    // three separate headers, which every peer understands.
+    const auto first = encoder.encode(io::encoded<reply_type::value>(1, std::string("payload")));
+
+    std::vector<asio::const_buffer> buffers;
+    first.buffers(std::back_inserter(buffers));
+
+    std::string encoded = flatten(buffers);
+
+    msgpack::unpacked result;
+    msgpack::unpack(&result, encoded.data(), encoded.size());
+
+    msgpack::object headers = result.get().via.array.ptr[3];
+
+    // The first one is the extension table advertisement.
+    ASSERT_EQ(4, headers.via.array.size);
+    ASSERT_EQ(header_static_table_t::idx<headers::trace_id<>>(),
+        headers.via.array.ptr[1].via.array.ptr[1].via.u64);
+    ASSERT_EQ(header_static_table_t::idx<headers::span_id<>>(),
+        headers.via.array.ptr[2].via.array.ptr[1].via.u64);
+    ASSERT_EQ(header_static_table_t::idx<headers::parent_id<>>(),
+        headers.via.array.ptr[3].via.array.ptr[1].via.u64);
+
+    // Once the peer has advertised it, the ids are packed together in the network byte order.
+    encoder.accept_extensions();
+
+    const auto second = encoder.encode(io::encoded<reply_type::value>(1, std::string("payload")));
+
+    buffers.clear();
+    second.buffers(std::back_inserter(buffers));
+
+    encoded = flatten(buffers);
+
+    msgpack::unpack(&result, encoded.data(), encoded.size());
+
+    headers = result.get().via.array.ptr[3];
+
+    ASSERT_EQ(1, headers.via.array.size);
+
+    const msgpack::object& value = headers.via.array.ptr[0].via.array.ptr[2];
+
+    ASSERT_EQ(std::string("\0\0\0\0\0\0\0\x01\0\0\0\0\0\0\0\x02\0\0\0\0\0\0\0\x03", 24),
+        std::string(value.via.raw.ptr, value.via.raw.size));
+}
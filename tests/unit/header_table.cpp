@@ -18,13 +18,18 @@
     along with this program. If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <cocaine/hpack/header.h>
 #include <cocaine/hpack/header.hpp>
 #include <cocaine/hpack/msgpack_traits.hpp>
 
+#include <msgpack.hpp>
+
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
 #include <random>
+#include <string>
+#include <vector>
 
 using namespace cocaine::hpack;
 
@@ -84,6 +89,44 @@ TEST(header_static_table_t, general) {
     ASSERT_EQ(headers.at(82), headers::make_header<headers::parent_id<>>());
 }
 
+TEST(header_extension_table_t, general) {
+    header_table_t table;
+    const size_t idx = header_extension_table_t::idx<headers::deadline<>>();
+
+    // Never clashes with the dynamic table entries, even when it's full of the smallest ones.
+    const size_t dynamic_bound = header_static_table_t::get_size() + header_table_t::max_header_capacity;
+    ASSERT_GE(idx, dynamic_bound);
+
+    ASSERT_EQ(table[idx], headers::make_header<headers::deadline<>>());
+    ASSERT_THROW(table[idx + 1], std::out_of_range);
+
+    // Extension entries are only referred to explicitly.
+    ASSERT_EQ(table.find_by_name(headers::make_header<headers::deadline<>>()), 0);
+}
+
+TEST(header_static_table_t, baseline_dynamic_index) {
+    // Metadata sent by a peer which knows nothing about the Cocaine specific headers added since the
+    // trace ids, so its dynamic table entries are indexed right after the 83 static ones.
+    const char metadata[] =
+        "\x92"                                  // Two headers:
+        "\x93\xc3\xa9test_name\xa9test_data"     // a literal one, stored in the dynamic table,
+        "\xcf\x00\x00\x00\x00\x00\x00\x00\x53"; // and a reference to the stored one.
+
+    msgpack::unpacked result;
+    msgpack::unpack(&result, metadata, sizeof(metadata) - 1);
+
+    header_table_t table;
+    std::vector<header_t> headers;
+
+    ASSERT_TRUE(msgpack_traits::unpack_vector(result.get(), table, headers, [](size_t) -> char* {
+        return nullptr;
+    }));
+
+    ASSERT_EQ(headers.size(), 2);
+    ASSERT_EQ(headers[0], headers::make_header<test_header_t>());
+    ASSERT_EQ(headers[1], headers::make_header<test_header_t>());
+}
+
 TEST(header_table_t, operator_sq_br) {
     header_table_t table;
     // 0  is not allowed
@@ -139,6 +182,33 @@ TEST(header_table_t, find_by_name) {
     ASSERT_EQ(table.find_by_name(h), header_static_table_t::idx<headers::span_id<>>());
 }
 
+TEST(header_table_t, find_after_eviction) {
+    header_table_t table;
+    std::vector<std::string> values;
+    std::vector<header_t> pushed;
+    for(size_t i = 0; i < 1000; i++) {
+        values.push_back(std::to_string(i * 7919));
+    }
+    for(size_t i = 0; i < values.size(); i++) {
+        header_t h(ch_header{{"test_name", 9}, {values[i].data(), values[i].size()}});
+        table.push(h);
+        pushed.push_back(h);
+
+        // Every live dynamic entry must be found at its current position.
+        size_t live = table.size() - header_static_table_t::get_size();
+        for(size_t j = 0; j < live; j++) {
+            const auto& expected = pushed[pushed.size() - live + j];
+            ASSERT_EQ(table.find_by_full_match(expected), header_static_table_t::get_size() + j);
+            ASSERT_EQ(table[header_static_table_t::get_size() + j], expected);
+        }
+        // Evicted ones must not.
+        if(pushed.size() > live) {
+            ASSERT_EQ(table.find_by_full_match(pushed[pushed.size() - live - 1]), 0);
+        }
+        ASSERT_EQ(table.find_by_name(h), header_static_table_t::get_size());
+    }
+}
+
 TEST(header_table_t, data_size) {
     header_table_t table;
     ASSERT_EQ(table.data_size(), 0);
@@ -0,0 +1,89 @@
+/*
+    Copyright (c) 2011-2015 Anton Matveenko <antmat@yandex-team.ru>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cocaine/hpack/huffman.hpp>
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+
+using namespace cocaine::hpack;
+
+namespace {
+
+std::string
+encode(const std::string& source) {
+    std::string result(huffman::encoded_size(source.data(), source.size()), '\0');
+    EXPECT_EQ(huffman::encode(source.data(), source.size(), &result[0]), result.size());
+    return result;
+}
+
+bool
+decode(const std::string& source, std::string& result) {
+    size_t decoded = 0;
+    result.resize(huffman::decoded_size_bound(source.size()));
+    if(!huffman::decode(source.data(), source.size(), &result[0], decoded)) {
+        return false;
+    }
+    result.resize(decoded);
+    return true;
+}
+
+} // namespace
+
+TEST(huffman, rfc_examples) {
+    // See https://tools.ietf.org/html/rfc7541#appendix-C.4
+    ASSERT_EQ(encode("www.example.com"), "\xf1\xe3\xc2\xe5\xf2\x3a\x6b\xa0\xab\x90\xf4\xff");
+    ASSERT_EQ(encode("no-cache"), "\xa8\xeb\x10\x64\x9c\xbf");
+    ASSERT_EQ(encode("custom-key"), "\x25\xa8\x49\xe9\x5b\xa9\x7d\x7f");
+    ASSERT_EQ(encode("custom-value"), "\x25\xa8\x49\xe9\x5b\xb8\xe8\xb4\xbf");
+
+    std::string result;
+    ASSERT_TRUE(decode("\xf1\xe3\xc2\xe5\xf2\x3a\x6b\xa0\xab\x90\xf4\xff", result));
+    ASSERT_EQ(result, "www.example.com");
+}
+
+TEST(huffman, round_trip) {
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::uniform_int_distribution<size_t> length(0, 128);
+    for(size_t i = 0; i < 10000; i++) {
+        std::string source(length(gen), '\0');
+        for(size_t j = 0; j < source.size(); j++) {
+            source[j] = static_cast<char>(byte(gen));
+        }
+        std::string result;
+        ASSERT_TRUE(decode(encode(source), result));
+        ASSERT_EQ(result, source);
+    }
+}
+
+TEST(huffman, invalid_input) {
+    std::string result;
+    // Padding longer than 7 bits.
+    ASSERT_FALSE(decode("\xff", result));
+    // Padding which is not a prefix of EOS.
+    ASSERT_FALSE(decode(std::string(1, '\0'), result));
+    // Explicit EOS.
+    ASSERT_FALSE(decode("\xff\xff\xff\xff", result));
+    ASSERT_TRUE(decode("", result));
+    ASSERT_TRUE(result.empty());
+}
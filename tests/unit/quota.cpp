@@ -0,0 +1,196 @@
+/*
+    Copyright (c) 2011-2015 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "session_fixture.hpp"
+
+#include <cocaine/detail/quota.hpp>
+
+using namespace cocaine;
+using namespace cocaine::io;
+
+namespace {
+
+typedef quota_t::clock_type clock_type;
+
+// Number of the messages consumed at the specified time until the rate limit is hit.
+size_t
+consume(quota_t& quota, clock_type::time_point now) {
+    size_t consumed = 0;
+
+    while(consumed < 1000 && quota.consume(now)) {
+        consumed++;
+    }
+
+    return consumed;
+}
+
+} // namespace
+
+TEST(quota_t, unlimited) {
+    quota_t quota(0, 0, 0);
+
+    const auto now = clock_type::now();
+
+    for(int i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(quota.open());
+        ASSERT_TRUE(quota.consume(now));
+    }
+}
+
+TEST(quota_t, channels) {
+    quota_t quota(2, 0, 0);
+
+    ASSERT_TRUE(quota.open());
+    ASSERT_TRUE(quota.open());
+
+    // The limit is reached, so no more channels until some are closed.
+    ASSERT_FALSE(quota.open());
+    ASSERT_FALSE(quota.open());
+
+    quota.close();
+
+    ASSERT_TRUE(quota.open());
+    ASSERT_FALSE(quota.open());
+
+    quota.close(2);
+
+    ASSERT_TRUE(quota.open());
+    ASSERT_TRUE(quota.open());
+    ASSERT_FALSE(quota.open());
+}
+
+TEST(quota_t, burst) {
+    quota_t quota(0, 100, 10);
+
+    const auto now = clock_type::now();
+
+    // The whole burst is tolerated at once, but nothing on top of it.
+    ASSERT_EQ(10, consume(quota, now));
+
+    // One message more is tolerated as soon as its period passes.
+    ASSERT_EQ(0, consume(quota, now + std::chrono::milliseconds(9)));
+    ASSERT_EQ(1, consume(quota, now + std::chrono::milliseconds(10)));
+
+    // The burst is replenished once the bucket has been idle for long enough, but never beyond it.
+    ASSERT_EQ(10, consume(quota, now + std::chrono::seconds(10)));
+}
+
+TEST(quota_t, steady_rate) {
+    quota_t quota(0, 100, 1);
+
+    const auto now = clock_type::now();
+
+    // Without a burst, exactly one message per period is allowed.
+    for(int i = 0; i < 100; ++i) {
+        ASSERT_EQ(1, consume(quota, now + std::chrono::milliseconds(10 * i)));
+    }
+
+    // Messages which arrive in between are rejected, and don't shift the schedule.
+    ASSERT_EQ(0, consume(quota, now + std::chrono::milliseconds(995)));
+    ASSERT_EQ(1, consume(quota, now + std::chrono::milliseconds(1000)));
+}
+
+TEST(quota_table_t, shared) {
+    quota_table_t table(1, 0, 0);
+
+    const auto quota = table.get("127.0.0.1");
+
+    // Sessions of the same address share the quota.
+    ASSERT_EQ(quota, table.get("127.0.0.1"));
+    ASSERT_NE(quota, table.get("127.0.0.2"));
+
+    ASSERT_TRUE(quota->open());
+    ASSERT_FALSE(table.get("127.0.0.1")->open());
+}
+
+TEST(session_t, acquire_rolls_back_on_address_quota) {
+    session_fixture_t fixture;
+
+    // The session quota is checked first, then the one of the remote address, like the engine does.
+    const auto own = std::make_shared<quota_t>(1, 0, 0);
+    const auto address = std::make_shared<quota_t>(1, 0, 0);
+
+    fixture.session->limit(own);
+    fixture.session->limit(address);
+
+    // Another session of the same address has exhausted the address quota.
+    ASSERT_TRUE(address->open());
+
+    fixture.send(encoded<session_test::call>(1, std::string("payload")));
+    fixture.session->pull();
+    fixture.receive();
+
+    ASSERT_EQ(1, fixture.message.span());
+    ASSERT_EQ(event_traits<session_test_reply::error>::id, fixture.message.type());
+    ASSERT_EQ(make_error_code(error::channel_quota_exceeded), fixture.error());
+
+    // The session quota has been opened before the address one failed, so it must be closed back.
+    ASSERT_TRUE(own->open());
+    own->close();
+
+    address->close();
+
+    fixture.send(encoded<session_test::call>(2, std::string("payload")));
+    fixture.receive();
+
+    ASSERT_EQ(2, fixture.message.span());
+    ASSERT_EQ(event_traits<session_test_reply::value>::id, fixture.message.type());
+}
+
+TEST(session_t, rate_limit_rejects_new_invocations) {
+    session_fixture_t fixture;
+
+    // One message per second without a burst, so the second one is over the limit.
+    fixture.session->limit(std::make_shared<quota_t>(0, 1, 1));
+
+    fixture.send(encoded<session_test::call>(1, std::string("payload")));
+    fixture.send(encoded<session_test::call>(2, std::string("payload")));
+
+    fixture.session->pull();
+    fixture.receive();
+
+    ASSERT_EQ(1, fixture.message.span());
+    ASSERT_EQ(event_traits<session_test_reply::value>::id, fixture.message.type());
+
+    fixture.receive();
+
+    ASSERT_EQ(2, fixture.message.span());
+    ASSERT_EQ(event_traits<session_test_reply::error>::id, fixture.message.type());
+    ASSERT_EQ(make_error_code(error::rate_limit_exceeded), fixture.error());
+
+    // New invocations are cheaply rejected, so the client is kept connected.
+    ASSERT_FALSE(fixture.session->is_detached());
+    ASSERT_EQ(1, fixture.calls);
+}
+
+TEST(session_t, rate_limit_disconnects_existing_channels) {
+    session_fixture_t fixture;
+
+    fixture.session->limit(std::make_shared<quota_t>(0, 1, 1));
+
+    // The second message is over the limit, but goes into the channel the first one has opened.
+    fixture.send(encoded<session_test::stream>(1, std::string("open")));
+    fixture.send(encoded<session_test::stream>(1, std::string("throttled")));
+
+    fixture.session->pull();
+
+    ASSERT_TRUE(fixture.run([&]() { return fixture.session->is_detached(); }));
+    ASSERT_EQ(1, fixture.calls);
+}
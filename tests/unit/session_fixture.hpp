@@ -0,0 +1,265 @@
+/*
+    Copyright (c) 2011-2015 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_UNIT_SESSION_FIXTURE_HPP
+#define COCAINE_UNIT_SESSION_FIXTURE_HPP
+
+#include <cocaine/errors.hpp>
+#include <cocaine/logging.hpp>
+
+#include <cocaine/idl/primitive.hpp>
+
+#include <cocaine/rpc/asio/transport.hpp>
+#include <cocaine/rpc/dispatch.hpp>
+#include <cocaine/rpc/session.hpp>
+
+#include <cocaine/traits/error_code.hpp>
+
+#include <asio/io_service.hpp>
+#include <asio/local/connect_pair.hpp>
+#include <asio/local/stream_protocol.hpp>
+#include <asio/write.hpp>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <functional>
+#include <thread>
+
+namespace cocaine { namespace io {
+
+struct session_test_tag;
+
+struct session_test {
+    struct call {
+        typedef session_test_tag tag;
+
+        static const char* alias() {
+            return "call";
+        }
+
+        typedef boost::mpl::list<
+            std::string
+        > argument_type;
+
+        typedef option_of<
+            std::string
+        >::tag upstream_type;
+    };
+
+    struct notify {
+        typedef session_test_tag tag;
+
+        static const char* alias() {
+            return "notify";
+        }
+
+        typedef boost::mpl::list<
+            std::string
+        > argument_type;
+
+        typedef void upstream_type;
+    };
+
+    // Keeps the channel open, so that the following messages are sent into the existing channel.
+    struct stream {
+        typedef session_test_tag tag;
+
+        static const char* alias() {
+            return "stream";
+        }
+
+        typedef boost::mpl::list<
+            std::string
+        > argument_type;
+
+        typedef session_test_tag dispatch_type;
+        typedef void upstream_type;
+    };
+};
+
+template<>
+struct protocol<session_test_tag> {
+    typedef boost::mpl::int_<
+        1
+    > version;
+
+    typedef boost::mpl::list<
+        session_test::call,
+        session_test::notify,
+        session_test::stream
+    > messages;
+
+    typedef session_test scope;
+};
+
+typedef primitive<boost::mpl::list<std::string>::type> session_test_reply;
+
+// Encodes a message into a contiguous frame.
+inline
+std::string
+frame(encoder_t& encoder, const encoder_t::message_type& unbound) {
+    const auto encoded = encoder.encode(unbound);
+
+    std::vector<asio::const_buffer> buffers;
+    std::string result;
+
+    encoded.buffers(std::back_inserter(buffers));
+
+    for(auto it = buffers.begin(); it != buffers.end(); ++it) {
+        result.append(asio::buffer_cast<const char*>(*it), asio::buffer_size(*it));
+    }
+
+    return result;
+}
+
+// Serves the test protocol over one end of a socket pair, the test plays the client on the other.
+struct session_fixture_t {
+    typedef asio::local::stream_protocol protocol_type;
+
+    asio::io_service reactor;
+
+    logging::logger_t logger;
+    protocol_type::socket peer;
+
+    std::shared_ptr<dispatch<session_test_tag>> service;
+    std::shared_ptr<cocaine::session<protocol_type>> session;
+
+    // Number of invocations which have reached the slot.
+    size_t calls;
+
+    encoder_t encoder;
+    decoder_t decoder;
+    decoder_t::message_type message;
+
+    std::string received;
+
+    session_fixture_t():
+        logger(logging::error),
+        peer(reactor),
+        service(std::make_shared<dispatch<session_test_tag>>("test")),
+        calls(0)
+    {
+        service->on<session_test::call>([this](const std::string& value) -> std::string {
+            calls++;
+            return value;
+        });
+
+        service->on<session_test::notify>([this](const std::string&) {
+            calls++;
+        });
+
+        service->on<session_test::stream>([this](const std::string&) {
+            calls++;
+        });
+
+        auto socket = std::make_unique<protocol_type::socket>(reactor);
+
+        asio::local::connect_pair(*socket, peer);
+
+        session = std::make_shared<cocaine::session<protocol_type>>(
+            std::make_unique<logging::log_t>(logger, blackhole::attribute::set_t()),
+            std::make_unique<transport<protocol_type>>(std::move(socket)),
+            service
+        );
+    }
+
+   ~session_fixture_t() {
+        if(!session->is_detached()) {
+            session->detach(std::error_code());
+        }
+    }
+
+    void
+    send(const encoder_t::message_type& unbound) {
+        const auto data = frame(encoder, unbound);
+        asio::write(peer, asio::buffer(data));
+    }
+
+    // Runs the session until the predicate holds, returns whether it does.
+    bool
+    run(const std::function<bool()>& predicate) {
+        for(int attempt = 0; attempt < 5000; ++attempt) {
+            if(predicate()) {
+                return true;
+            }
+
+            reactor.reset();
+            reactor.poll();
+
+            if(!predicate()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+
+        return predicate();
+    }
+
+    // Runs the session until the specified number of invocations have reached the slots.
+    void
+    handle(size_t count) {
+        run([&]() { return calls >= count; });
+
+        ASSERT_EQ(count, calls);
+    }
+
+    // Runs the session until the next message sent by it is decoded.
+    void
+    receive() {
+        message.clear();
+
+        for(int attempt = 0; attempt < 5000; ++attempt) {
+            std::error_code ec;
+
+            const size_t offset = decoder.decode(received.data(), received.size(), message, ec);
+
+            if(!ec) {
+                received.erase(0, offset);
+                return;
+            }
+
+            ASSERT_EQ(make_error_code(error::insufficient_bytes), ec);
+
+            reactor.reset();
+            reactor.poll();
+
+            if(const size_t available = peer.available()) {
+                std::vector<char> chunk(available);
+                received.append(chunk.data(), peer.read_some(asio::buffer(chunk)));
+            } else {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+
+        FAIL() << "no message has been received";
+    }
+
+    // Error code the last received message carries.
+    std::error_code
+    error() const {
+        std::error_code ec;
+        type_traits<std::error_code>::unpack(message.args().via.array.ptr[0], ec);
+        return ec;
+    }
+};
+
+}} // namespace cocaine::io
+
+#endif
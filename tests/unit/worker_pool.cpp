@@ -0,0 +1,149 @@
+/*
+    Copyright (c) 2011-2015 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cocaine/rpc/worker_pool.hpp>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+
+using namespace cocaine::io;
+
+namespace {
+
+// Keeps the tasks running until released, so that the queue fills up deterministically.
+struct gate_t {
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool open;
+
+    gate_t(): open(false) { }
+
+    void
+    wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this] { return open; });
+    }
+
+    void
+    release() {
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            open = true;
+        }
+
+        condition.notify_all();
+    }
+};
+
+// Waits until the pool's workers have picked up the specified number of tasks.
+void
+wait_active(const worker_pool_t& pool, size_t count) {
+    for(int attempt = 0; attempt < 5000 && pool.stats().active < count; ++attempt) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    ASSERT_EQ(count, pool.stats().active);
+}
+
+} // namespace
+
+TEST(worker_pool_t, queue_limit) {
+    gate_t gate;
+    worker_pool_t pool("test/workers", 1, 2);
+
+    // The only worker is busy with the first task, and the next two are queued.
+    ASSERT_TRUE(pool.post([&] { gate.wait(); }));
+
+    wait_active(pool, 1);
+
+    ASSERT_TRUE(pool.post([&] { gate.wait(); }));
+    ASSERT_TRUE(pool.post([&] { gate.wait(); }));
+
+    // The queue is full, so the next one is rejected right away instead of blocking.
+    ASSERT_FALSE(pool.post([&] { gate.wait(); }));
+
+    auto stats = pool.stats();
+
+    ASSERT_EQ(2, stats.pending);
+    ASSERT_EQ(1, stats.active);
+    ASSERT_EQ(0, stats.completed);
+    ASSERT_EQ(1, stats.rejected);
+
+    gate.release();
+
+    for(int attempt = 0; attempt < 5000 && pool.stats().completed < 3; ++attempt) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    stats = pool.stats();
+
+    ASSERT_EQ(0, stats.pending);
+    ASSERT_EQ(0, stats.active);
+    ASSERT_EQ(3, stats.completed);
+    ASSERT_EQ(1, stats.rejected);
+}
+
+TEST(worker_pool_t, destructor_drains_queue) {
+    std::atomic<size_t> completed(0);
+
+    {
+        gate_t gate;
+        worker_pool_t pool("test/workers", 2, 16);
+
+        for(int i = 0; i < 16; ++i) {
+            ASSERT_TRUE(pool.post([&] {
+                gate.wait();
+                completed++;
+            }));
+        }
+
+        gate.release();
+    }
+
+    // Every task accepted by the pool has run by the time it's destroyed.
+    ASSERT_EQ(16, completed);
+}
+
+TEST(worker_pool_t, destroyed_from_worker) {
+    auto pool = std::make_shared<worker_pool_t>("test/workers", 1, 4);
+
+    std::promise<void> done;
+    auto future = done.get_future();
+
+    gate_t gate;
+
+    // The task holds the last reference to the pool, so the pool is destroyed on its own worker
+    // thread once the task is complete, which must neither deadlock nor crash.
+    ASSERT_TRUE(pool->post([pool, &gate, &done]() mutable {
+        gate.wait();
+        pool.reset();
+        done.set_value();
+    }));
+
+    pool.reset();
+    gate.release();
+
+    ASSERT_EQ(std::future_status::ready, future.wait_for(std::chrono::seconds(5)));
+}